@@ -1,4 +1,4 @@
-#include <infint.h>
+#include "intcode.h"
 #include <map>
 #include <list>
 #include <limits>
@@ -13,200 +13,6 @@
 #include <algorithm>
 
 
-class Intcode final {
-private:
-  static size_t constexpr cInstLengths[] = {1u, 4u, 4u, 2u, 2u, 3u, 3u, 4u, 4u, 2u, 1u};
-  static int    const cAdd              =  1;
-  static int    const cMultiply         =  2;
-  static int    const cInput            =  3;
-  static int    const cOutput           =  4;
-  static int    const cJumpIfNot0       =  5;
-  static int    const cJumpIf0          =  6;
-  static int    const cLessThan         =  7;
-  static int    const cEquals           =  8;
-  static int    const cRelativeBase     =  9;
-  static int    const cInstCount        = 10;
-  static int    const cHalt             = 99;
-  static int    const cMaskOpcode       = 100;
-  static size_t const cOffsetParameter1 =   1u;
-  static size_t const cOffsetParameter2 =   2u;
-  static size_t const cOffsetResult     =   3u;
-
-  std::list<InfInt>  mInputs;
-  std::list<InfInt>  mOutputs;
-  std::deque<InfInt> mProgram;
-  std::deque<InfInt> mMemory;
-  size_t          mProgramCounter;
-  size_t          mRelativeBase;
-
-public:
-  Intcode() noexcept = default;
-
-  Intcode(std::ifstream &aIn) noexcept {
-    while(true) {
-      std::string number;
-      std::getline(aIn, number, ',');
-      if(!aIn.good()) {
-        break;
-      }
-      InfInt integer(number);
-      mProgram.push_back(integer);
-    }
-  }
-
-  Intcode(Intcode const &aOther) noexcept : mProgram(aOther.mProgram) {
-  }
-
-  void input(int const aInput) noexcept {
-    mInputs.push_back(aInput);
-  }
-
-  InfInt output() {
-    return get(mOutputs);
-  }
-  
-  bool hasOutput() {
-    return !mOutputs.empty();
-  }
-
-  void start() {
-    mInputs.clear();
-    mOutputs.clear();
-    mMemory = mProgram;
-    mProgramCounter = 0u;
-    mRelativeBase   = 0u;
-  }
-
-  bool run() {
-    bool result;
-    while(true) {
-      if(mProgramCounter >= mMemory.size()) {
-        throw std::invalid_argument("Invalid program.");
-      }
-      else { // nothing to do
-      }
-      InfInt opcode = mMemory[mProgramCounter] % cMaskOpcode;
-      if(opcode != cHalt && opcode >= cInstCount) {
-        throw std::invalid_argument("Invalid program.");
-      }
-      else { // nothing to do
-      }
-    
-      bool jumped = false; 
-      if(opcode == cAdd) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = mMemory[addressParameter1] + mMemory[addressParameter2];
-      }
-      else if(opcode == cMultiply) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = mMemory[addressParameter1] * mMemory[addressParameter2];
-      }
-      else if(opcode == cInput) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        if(mInputs.size() == 0u) {
-          result = false;
-          break;
-        }
-        else {
-          mMemory[addressParameter1] = get(mInputs);
-        }
-      }
-      else if(opcode == cOutput) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        mOutputs.push_back(mMemory[addressParameter1]);
-      }
-      else if(opcode == cJumpIfNot0) {
-        size_t addressToCheck = getAddress(cOffsetParameter1);
-        size_t addressOfJUmp = getAddress(cOffsetParameter2);
-        if(mMemory[addressToCheck] != 0) {
-          mProgramCounter = mMemory[addressOfJUmp].toInt();
-          jumped = true;
-        }
-        else { // nothing to do
-        }
-      }
-      else if(opcode == cJumpIf0) {
-        size_t addressToCheck = getAddress(cOffsetParameter1);
-        size_t addressOfJUmp = getAddress(cOffsetParameter2);
-        if(mMemory[addressToCheck] == 0) {
-          mProgramCounter = mMemory[addressOfJUmp].toInt();
-          jumped = true;
-        }
-        else { // nothing to do
-        }
-      }
-      else if(opcode == cLessThan) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = (mMemory[addressParameter1] < mMemory[addressParameter2] ? 1 : 0);
-      }
-      else if(opcode == cEquals) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = (mMemory[addressParameter1] == mMemory[addressParameter2] ? 1 : 0);
-      }
-      else if(opcode == cRelativeBase) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        mRelativeBase += mMemory[addressParameter1].toInt();
-      }
-      else if(opcode == cHalt) {
-        result = true;
-        break;
-      }
-      else { // nothing to do
-      }
-      if(!jumped) {
-        mProgramCounter += cInstLengths[opcode.toInt()];
-      }
-      else { // nothing to do
-      }
-    }
-    return result;
-  }
-
-private:
-  size_t getAddress(size_t const aOffset) noexcept {
-    InfInt const dividor[] = {0, 100, 1000, 10000};
-    InfInt digit = (mMemory[mProgramCounter] / dividor[aOffset]) % 10;
-    size_t result;
-    if(digit == 0) {
-      result = mMemory[mProgramCounter + aOffset].toInt();
-    }
-    else if(digit == 2) {
-      result = mMemory[mProgramCounter + aOffset].toInt() + mRelativeBase;
-    }
-    else { // else 1, immediate
-      result = mProgramCounter + aOffset;
-    }
-    if(result >= mMemory.size()) {
-      InfInt zero{0};
-      mMemory.resize(result + 1u, zero);
-    }
-    else { // nothing to do
-    }
-    return result;
-  }
-  
-  InfInt get(std::list<InfInt> &aList) {
-    if(aList.size() == 0u) {
-      throw std::invalid_argument("List empty.");
-    }
-    else { // nothing to do
-    }
-    InfInt result = aList.front();
-    aList.pop_front();
-    return result;
-  }
-};
-
-size_t constexpr Intcode::cInstLengths[];
-
 void paint(std::ifstream &aIn) {
   int constexpr cBlack = 0;
   int constexpr cWhite = 1;
@@ -214,7 +20,7 @@ void paint(std::ifstream &aIn) {
   int const     cDeltas[cDirectionCount][2] = { {0, -1}, {1, 0}, {0, 1}, {-1, 0}};
 
   std::map<std::pair<int, int>, int> painted;
-  Intcode computer(aIn);
+  Intcode<SafeInt> computer(aIn);
   std::pair<int, int> location(0, 0);
   painted[location] = cWhite;
   computer.start();
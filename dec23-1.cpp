@@ -1,8 +1,12 @@
-#include "infint.h"
+#include "intcode.h"
+#include "intcode-image.h"
+#include "intcode-trace.h"
+#include "intcode-network.h"
 #include <list>
 #include <array>
 #include <deque>
 #include <limits>
+#include <memory>
 #include <chrono>
 #include <cctype>
 #include <string>
@@ -14,289 +18,80 @@
 #include <stdexcept>
 #include <algorithm>
 
-class Int final {
-private:
-  int64_t mInt;
-
-public:
-  Int() noexcept = default;
-
-  Int(int aInt) noexcept : mInt(aInt) {
-  }
-
-  Int(std::string &aString) : mInt(std::stol(aString)) {
-  }
-
-  int64_t toInt() const noexcept {
-    return mInt;
-  }
-
-  operator int64_t() const noexcept {
-    return mInt;
-  }
-
-  Int &operator=(int64_t const aInt) noexcept {
-    mInt = aInt;
-    return *this;
-  }
+struct Message final {
+  Int x;
+  Int y;
 };
 
-template<typename tNumber>
-class Intcode final {
+class Network final {
 private:
-  static size_t constexpr cInstLengths[] = {1u, 4u, 4u, 2u, 2u, 3u, 3u, 4u, 4u, 2u, 1u};
-  static int    const cAdd              =  1;
-  static int    const cMultiply         =  2;
-  static int    const cInput            =  3;
-  static int    const cOutput           =  4;
-  static int    const cJumpIfNot0       =  5;
-  static int    const cJumpIf0          =  6;
-  static int    const cLessThan         =  7;
-  static int    const cEquals           =  8;
-  static int    const cRelativeBase     =  9;
-  static int    const cInstCount        = 10;
-  static int    const cHalt             = 99;
-  static int    const cMaskOpcode       = 100;
-  static size_t const cOffsetParameter1 =   1u;
-  static size_t const cOffsetParameter2 =   2u;
-  static size_t const cOffsetResult     =   3u;
+  static constexpr size_t  cComputerCount = 50u;
+  static constexpr int64_t cNoMessage     = -1;
+  static constexpr size_t  cMessageSize   = 3u;
+  static constexpr size_t  cTimeSlice     = 10000u;   // steps a computer runs before the next one gets its turn
+  static constexpr size_t  cTraceInterval = 200u;     // inputs and outputs between the checkpoints of a trace
 
-  std::list<tNumber>  mInputs;
-  std::list<tNumber>  mOutputs;
-  std::deque<tNumber> mProgram;
-  std::deque<tNumber> mMemory;
-  size_t              mProgramCounter;
-  size_t              mRelativeBase;
+  Intcode<Int>                                   mMaster;
+  std::array<Intcode<Int>, cComputerCount>        mComputers;
+  std::array<std::list<Message>, cComputerCount> mQueues;
+  std::array<Intcode<Int>::Status, cComputerCount> mStates;
+  std::ofstream                                  mTraceFile;
+  std::unique_ptr<IntcodeRecorder<Int>>          mRecorder;
 
 public:
-  Intcode() = default;
-
-  Intcode(std::ifstream &aIn) {
-    while(true) {
-      std::string number;
-      std::getline(aIn, number, ',');
-      if(!aIn.good()) {
-        break;
+  // Records a trace of the computers into aTraceFilename unless it is empty, see intcode-trace.h. Only
+  // then the computers are set up here, running in parallel sets up its own.
+  Network(std::string const &aFilename, std::string const &aTraceFilename) : mMaster(loadIntcode<Int>(aFilename)) {
+    if(!aTraceFilename.empty()) {
+      for(int64_t i = 0; i < cComputerCount; ++i) {
+        Intcode<Int> &computer = mComputers[i];
+        computer = mMaster;
+        computer.start();
+        computer.input(i);
+      }
+      mTraceFile.open(aTraceFilename, std::ios::binary);
+      mRecorder.reset(new IntcodeRecorder<Int>(mTraceFile, cTraceInterval));
+      for(auto &computer : mComputers) {
+        mRecorder->add(computer);
       }
-      tNumber integer(number);
-      mProgram.push_back(integer);
     }
-  }
-
-  Intcode(Intcode const &aOther) noexcept : mProgram(aOther.mProgram) {
-  }
-
-  Intcode &operator=(Intcode const &aOther) noexcept {
-    mProgram = aOther.mProgram;
-  }
-
-  void input(tNumber const &aInput) noexcept {
-    mInputs.push_back(aInput);
-  }
-
-  void input(int64_t const aInput) noexcept {
-    mInputs.push_back(aInput);
-  }
-
-  void input(std::string const &aInput) noexcept {
-    for(auto &i : aInput) {
-      mInputs.push_back(static_cast<int64_t>(i));
+    else { // nothing to do
     }
   }
 
-  tNumber output() {
-    return get(mOutputs);
-  }
-  
-  bool hasOutput() {
-    return !mOutputs.empty();
-  }
-
-  void printStatus() const noexcept {
-    std::cout << "input: " << mInputs.size() << " output: " << mOutputs.size() << " memory: " << mMemory.size() << '\n';
-
-  }
-
-  void start() {
-    mInputs.clear();
-    mOutputs.clear();
-    mMemory = mProgram;
-    mProgramCounter = 0u;
-    mRelativeBase   = 0u;
-  }
-
-  void poke(size_t const aLocation, tNumber const &aValue) {
-    expand(aLocation);
-    mMemory[aLocation] = aValue;
-  }
-
-  bool run() {
-    bool result;
-    while(true) {
-      if(mProgramCounter >= mMemory.size()) {
-        throw std::invalid_argument("Invalid program.");
-      }
-      else { // nothing to do
-      }
-      tNumber opcode = mMemory[mProgramCounter] % cMaskOpcode;
-      if(opcode != cHalt && opcode >= cInstCount) {
-        throw std::invalid_argument("Invalid program.");
-      }
-      else { // nothing to do
-      }
-    
-      bool jumped = false; 
-      if(opcode == cAdd) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = mMemory[addressParameter1] + mMemory[addressParameter2];
-      }
-      else if(opcode == cMultiply) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = mMemory[addressParameter1] * mMemory[addressParameter2];
-      }
-      else if(opcode == cInput) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        if(mInputs.size() == 0u) {
-          result = false;
-          break;
-        }
-        else {
-          mMemory[addressParameter1] = get(mInputs);
-        }
-      }
-      else if(opcode == cOutput) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        mOutputs.push_back(mMemory[addressParameter1]);
-      }
-      else if(opcode == cJumpIfNot0) {
-        size_t addressToCheck = getAddress(cOffsetParameter1);
-        size_t addressOfJUmp = getAddress(cOffsetParameter2);
-        if(mMemory[addressToCheck] != 0) {
-          mProgramCounter = mMemory[addressOfJUmp].toInt();
-          jumped = true;
-        }
-        else { // nothing to do
-        }
-      }
-      else if(opcode == cJumpIf0) {
-        size_t addressToCheck = getAddress(cOffsetParameter1);
-        size_t addressOfJUmp = getAddress(cOffsetParameter2);
-        if(mMemory[addressToCheck] == 0) {
-          mProgramCounter = mMemory[addressOfJUmp].toInt();
-          jumped = true;
-        }
-        else { // nothing to do
-        }
-      }
-      else if(opcode == cLessThan) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = (mMemory[addressParameter1] < mMemory[addressParameter2] ? 1 : 0);
-      }
-      else if(opcode == cEquals) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = (mMemory[addressParameter1] == mMemory[addressParameter2] ? 1 : 0);
-      }
-      else if(opcode == cRelativeBase) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        mRelativeBase += mMemory[addressParameter1].toInt();
-      }
-      else if(opcode == cHalt) {
-        result = true;
-        break;
-      }
-      else { // nothing to do
-      }
-      if(!jumped) {
-        mProgramCounter += cInstLengths[opcode.toInt()];
-      }
-      else { // nothing to do
-      }
-    }
-    return result;
+  // The computers run on all hardware threads, unless recording a trace, which takes them in turns.
+  int64_t compute() {
+    return mRecorder != nullptr ? computeInTurns() : computeInParallel();
   }
 
 private:
-  size_t getAddress(size_t const aOffset) {
-    tNumber const dividor[] = {0, 100, 1000, 10000};
-    tNumber digit = (mMemory[mProgramCounter] / dividor[aOffset]) % 10;
-    size_t result;
-    if(digit == 0) {
-      result = mMemory[mProgramCounter + aOffset].toInt();
-    }
-    else if(digit == 2) {
-      result = mMemory[mProgramCounter + aOffset].toInt() + mRelativeBase;
-    }
-    else { // else 1, immediate
-      result = mProgramCounter + aOffset;
-    }
-    expand(result);
-    return result;
-  }
-
-  void expand(size_t const aLocation) {
-    if(aLocation >= mMemory.size()) {
-      tNumber zero = 0;
-      mMemory.resize(aLocation + 1u, zero);
-    }
-    else { // nothing to do
-    }
-  }
-  
-  tNumber get(std::list<tNumber> &aList) {
-    if(aList.size() == 0u) {
-      throw std::invalid_argument("List empty.");
+  int64_t computeInParallel() {
+    bool found = false;
+    int64_t result = 0;
+    IntcodeNetwork<Int> network(mMaster, cComputerCount);
+    network.run([&found, &result](int64_t const, IntcodeNetwork<Int>::Packet const &aPacket) {
+      result = aPacket.y.toInt();
+      found = true;
+      return true;
+    }, []() {
+      return false;
+    });
+    if(!found) {     // all computers halted
+      throw std::invalid_argument("No answer from the network.");
     }
     else { // nothing to do
     }
-    tNumber result = aList.front();
-    aList.pop_front();
     return result;
   }
-};
-
-template<typename tNumber>
-size_t constexpr Intcode<tNumber>::cInstLengths[];
-
-struct Message final {
-  Int x;
-  Int y;
-};
-
-class Network final {
-private:
-  static constexpr size_t  cComputerCount = 50u;
-  static constexpr int64_t cNoMessage     = -1u;
-
-  std::array<Intcode<Int>, cComputerCount>        mComputers;
-  std::array<std::list<Message>, cComputerCount> mQueues;
-
-public:
-  Network(std::ifstream &aIn) {
-    Intcode<Int> master(aIn);
-    for(int64_t i = 0; i < cComputerCount; ++i) {
-      Intcode<Int> &computer = mComputers[i];
-      computer = master;
-      computer.start();
-      computer.input(i);
-    }
-  }
 
-  int64_t compute() {
+  int64_t computeInTurns() {
     bool found = false;
     int64_t result;
     while(!found) {
       for(size_t i = 0; i < cComputerCount; ++i) {
         Intcode<Int> &computer = mComputers[i];
-        computer.run();
-        while(!found && computer.hasOutput()) {
+        mStates[i] = mRecorder->run(i, cTimeSlice);
+        while(!found && computer.outputQueue()->size() >= cMessageSize) {   // a preempted computer may be amid a message
           int64_t address = computer.output().toInt();
           Message message;
           message.x = computer.output();
@@ -321,7 +116,7 @@ public:
           computer.input(message.x);
           computer.input(message.y);
         }
-        if(!found && !got) {
+        if(!found && !got && mStates[i] == Intcode<Int>::Status::cSuspended) {
           computer.input(cNoMessage);
         }
         else { // nothing to do
@@ -330,8 +125,6 @@ public:
     }
     return result;
   }
-
-private:
 };
 
 int main(int const argc, char **argv) {
@@ -342,9 +135,7 @@ int main(int const argc, char **argv) {
     if(argc == 1) {
       throw std::invalid_argument("Need input filename.");
     }
-    std::ifstream in(argv[1]);
-    
-    Network network(in);
+    Network network(argv[1], argc > 2 ? argv[2] : "");
     auto begin = std::chrono::high_resolution_clock::now();
     int64_t result = network.compute();
     auto end = std::chrono::high_resolution_clock::now();
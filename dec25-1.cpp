@@ -1,4 +1,5 @@
-#include "infint.h"
+#include "intcode.h"
+#include "intcode-jit.h"
 #include <list>
 #include <array>
 #include <deque>
@@ -6,6 +7,7 @@
 #include <chrono>
 #include <cctype>
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <utility>
 #include <optional>
@@ -20,278 +22,6 @@
 // However, I suppose that if I arrive from A to B using a direction,
 // I can leave from B to A using the opposite direction.
 
-class Int final {
-private:
-  int64_t mInt;
-
-public:
-  Int() noexcept = default;
-
-  Int(int64_t aInt) noexcept : mInt(aInt) {
-  }
-
-  Int(std::string &aString) : mInt(std::stoll(aString)) {
-  }
-
-  int64_t toInt() const noexcept {
-    return mInt;
-  }
-
-  operator int64_t() const noexcept {
-    return mInt;
-  }
-
-  Int &operator=(int64_t const aInt) noexcept {
-    mInt = aInt;
-    return *this;
-  }
-};
-
-template<typename tNumber>
-class Intcode final {
-private:
-  static size_t constexpr cInstLengths[] = {1u, 4u, 4u, 2u, 2u, 3u, 3u, 4u, 4u, 2u, 1u};
-  static int    const cAdd              =  1;
-  static int    const cMultiply         =  2;
-  static int    const cInput            =  3;
-  static int    const cOutput           =  4;
-  static int    const cJumpIfNot0       =  5;
-  static int    const cJumpIf0          =  6;
-  static int    const cLessThan         =  7;
-  static int    const cEquals           =  8;
-  static int    const cRelativeBase     =  9;
-  static int    const cInstCount        = 10;
-  static int    const cHalt             = 99;
-  static int    const cMaskOpcode       = 100;
-  static size_t const cOffsetParameter1 =   1u;
-  static size_t const cOffsetParameter2 =   2u;
-  static size_t const cOffsetResult     =   3u;
-
-  std::list<tNumber>  mInputs;
-  std::list<tNumber>  mOutputs;
-  std::deque<tNumber> mProgram;
-  std::deque<tNumber> mMemory;
-  size_t              mProgramCounter;
-  size_t              mRelativeBase;
-
-public:
-  Intcode() = default;
-
-  Intcode(std::ifstream &aIn) {
-    while(true) {
-      std::string number;
-      std::getline(aIn, number, ',');
-      if(!aIn.good()) {
-        break;
-      }
-      tNumber integer(number);
-      mProgram.push_back(integer);
-    }
-  }
-
-  Intcode(Intcode const &aOther) = default;
-  Intcode &operator=(Intcode const &aOther) = default;
-
-  void input(tNumber const &aInput) noexcept {
-    mInputs.push_back(aInput);
-  }
-
-  void input(int64_t const aInput) noexcept {
-    mInputs.push_back(aInput);
-  }
-
-  void input(std::string const &aInput) noexcept {
-    for(auto &i : aInput) {
-      mInputs.push_back(static_cast<int64_t>(i));
-    }
-    mInputs.push_back(static_cast<int64_t>('\n'));
-  }
-
-  tNumber output() {
-    return get(mOutputs);
-  }
-
-  std::string outputLine() {
-    std::string line;
-    while(hasOutput()) {
-      int64_t ch = get(mOutputs).toInt();
-      if(ch != '\n') {
-        line.push_back(ch);
-      }
-      else if(line.size() > 0u) {
-        break;
-      }
-      else { // nothing to do
-      }  
-    }
-    return line;
-  }
-
-  void skipOutput() {
-    mOutputs.clear();
-  }
-  
-  bool hasOutput() {
-    return !mOutputs.empty();
-  }
-
-  void printStatus() const noexcept {
-    std::cout << "input: " << mInputs.size() << " output: " << mOutputs.size() << " memory: " << mMemory.size() << '\n';
-
-  }
-
-  void start() {
-    mInputs.clear();
-    mOutputs.clear();
-    mMemory = mProgram;
-    mProgramCounter = 0u;
-    mRelativeBase   = 0u;
-  }
-
-  void poke(size_t const aLocation, tNumber const &aValue) {
-    expand(aLocation);
-    mMemory[aLocation] = aValue;
-  }
-
-  bool run() {
-    bool result;
-    while(true) {
-      if(mProgramCounter >= mMemory.size()) {
-        std::string message("PC: ");
-        message += std::to_string(mProgramCounter);
-        message += " mem: ";
-        message += std::to_string(mMemory.size());
-        throw std::invalid_argument(message);
-      }
-      else { // nothing to do
-      }
-      tNumber opcode = mMemory[mProgramCounter] % cMaskOpcode;
-      if(opcode != cHalt && opcode >= cInstCount) {
-        throw std::invalid_argument("Invalid program.");
-      }
-      else { // nothing to do
-      }
-    
-      bool jumped = false; 
-      if(opcode == cAdd) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = mMemory[addressParameter1] + mMemory[addressParameter2];
-      }
-      else if(opcode == cMultiply) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = mMemory[addressParameter1] * mMemory[addressParameter2];
-      }
-      else if(opcode == cInput) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        if(mInputs.size() == 0u) {
-          result = false;
-          break;
-        }
-        else {
-          mMemory[addressParameter1] = get(mInputs);
-        }
-      }
-      else if(opcode == cOutput) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        mOutputs.push_back(mMemory[addressParameter1]);
-      }
-      else if(opcode == cJumpIfNot0) {
-        size_t addressToCheck = getAddress(cOffsetParameter1);
-        size_t addressOfJUmp = getAddress(cOffsetParameter2);
-        if(mMemory[addressToCheck] != 0) {
-          mProgramCounter = mMemory[addressOfJUmp].toInt();
-          jumped = true;
-        }
-        else { // nothing to do
-        }
-      }
-      else if(opcode == cJumpIf0) {
-        size_t addressToCheck = getAddress(cOffsetParameter1);
-        size_t addressOfJUmp = getAddress(cOffsetParameter2);
-        if(mMemory[addressToCheck] == 0) {
-          mProgramCounter = mMemory[addressOfJUmp].toInt();
-          jumped = true;
-        }
-        else { // nothing to do
-        }
-      }
-      else if(opcode == cLessThan) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = (mMemory[addressParameter1] < mMemory[addressParameter2] ? 1 : 0);
-      }
-      else if(opcode == cEquals) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = (mMemory[addressParameter1] == mMemory[addressParameter2] ? 1 : 0);
-      }
-      else if(opcode == cRelativeBase) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        mRelativeBase += mMemory[addressParameter1].toInt();
-      }
-      else if(opcode == cHalt) {
-        result = true;
-        break;
-      }
-      else { // nothing to do
-      }
-      if(!jumped) {
-        mProgramCounter += cInstLengths[opcode.toInt()];
-      }
-      else { // nothing to do
-      }
-    }
-    return result;
-  }
-
-private:
-  size_t getAddress(size_t const aOffset) {
-    tNumber const dividor[] = {0, 100, 1000, 10000};
-    tNumber digit = (mMemory[mProgramCounter] / dividor[aOffset]) % 10;
-    size_t result;
-    if(digit == 0) {
-      result = mMemory[mProgramCounter + aOffset].toInt();
-    }
-    else if(digit == 2) {
-      result = mMemory[mProgramCounter + aOffset].toInt() + mRelativeBase;
-    }
-    else { // else 1, immediate
-      result = mProgramCounter + aOffset;
-    }
-    expand(result);
-    return result;
-  }
-
-  void expand(size_t const aLocation) {
-    if(aLocation >= mMemory.size()) {
-      tNumber zero = 0;
-      mMemory.resize(aLocation + 1u, zero);
-    }
-    else { // nothing to do
-    }
-  }
-  
-  tNumber get(std::list<tNumber> &aList) {
-    if(aList.size() == 0u) {
-      throw std::invalid_argument("List empty.");
-    }
-    else { // nothing to do
-    }
-    tNumber result = aList.front();
-    aList.pop_front();
-    return result;
-  }
-};
-
-template<typename tNumber>
-size_t constexpr Intcode<tNumber>::cInstLengths[];
-
 struct Room final {
   static constexpr uint8_t  cDirNameLength = 6u;
   static constexpr uint8_t       cDirCount = 4u;
@@ -324,7 +54,7 @@ struct Room final {
     }
   }
 
-  void setDoor(std::string const &aDoor) {
+  void setDoor(std::string_view const aDoor) {
     for(size_t i = 0; i < cDirCount; ++i) {
       if(aDoor.find(cDirNames[i]) == cPrefixSize && doors[i] == cWall) {
         doors[i] = cNotVisited;
@@ -407,6 +137,7 @@ private:
   static constexpr char   cCheckpointName[]      = "== Security Checkpoint ==";
   static constexpr char   cSensitiveName[]      = "== Pressure-Sensitive Floor ==";
  
+  IntcodeJit                                   mJit;
   Intcode<Int>                                 mComputer;
   std::unordered_map<std::string, Room>        mMap;
   std::unordered_map<std::string, std::string> mObjects;
@@ -414,12 +145,22 @@ private:
 
 public:
   Adventure(std::ifstream &aIn) : mComputer(aIn) {
+#ifndef INTCODE_PROFILE
+    mComputer.attach(mJit.compiler());   // profiling interprets everything, to see each instruction
+#endif
     mComputer.start();
   }
 
+#ifdef INTCODE_PROFILE
+  void printProfile() const {
+    mComputer.profile().print(std::cerr);
+  }
+
+#endif
+
   void gatherObjects() {
     bool foundSecurity = false;
-    mComputer.run();
+    mComputer.runAscii();
     RoomResult start = handleRoom(Room::cNowhere, Room::cDirNames[Room::cDirCount]);
     std::pair<std::string, Room> toInsert(start.name, start.room);
     auto here = mMap.insert(toInsert).first; // insert: first is iterator, second is bool
@@ -438,8 +179,8 @@ public:
       }
       else { // nothing to do
       }
-      mComputer.input(direction);
-      mComputer.run();
+      mComputer.inputLine(direction);
+      mComputer.runAscii();
       RoomResult roomCandidate = handleRoom(here->first, direction);
       here->second.setDoor(roomCandidate.name, direction);
       if(roomCandidate.name == cCheckpointName) {
@@ -476,9 +217,9 @@ public:
       }
     }
     for(auto &dir : mSurveyPath) {
-      mComputer.input(dir);
-      mComputer.run();
-      mComputer.skipOutput();
+      mComputer.inputLine(dir);
+      mComputer.runAscii();
+      mComputer.skipAscii();
     }
     auto here = mMap.find(cCheckpointName);
     uint64_t bitCount = objects.size();
@@ -505,14 +246,14 @@ public:
         }
       }
       command += objects[bit];
-      mComputer.input(command);
-      mComputer.run();
-      mComputer.skipOutput();
-      mComputer.input(here->second.sensitiveDir);
-      mComputer.run();
-      std::string lastLine;
-      while(mComputer.hasOutput()) {
-        lastLine = mComputer.outputLine();
+      mComputer.inputLine(command);
+      mComputer.runAscii();
+      mComputer.skipAscii();
+      mComputer.inputLine(here->second.sensitiveDir);
+      mComputer.runAscii();
+      std::string_view lastLine;
+      while(mComputer.hasAscii()) {
+        lastLine = mComputer.asciiLine();
       }
       if(lastLine != cMagicCommand) {
         result = lastLine;
@@ -526,12 +267,12 @@ public:
 
 private:
   RoomResult handleRoom(std::string const &aPreviousName, std::string const &aDir2reachHere) {
-    std::string line = mComputer.outputLine(); // room name
-    RoomResult result(line, Room(aPreviousName, aDir2reachHere), false);
-    line = mComputer.outputLine();             // description
-    line = mComputer.outputLine();             // cMagicDoors
+    std::string_view line = mComputer.asciiLine(); // room name
+    RoomResult result(std::string(line), Room(aPreviousName, aDir2reachHere), false);
+    line = mComputer.asciiLine();             // description
+    line = mComputer.asciiLine();             // cMagicDoors
     while(true) {
-      line = mComputer.outputLine();
+      line = mComputer.asciiLine();
       if(line.find(cMagicPossiblePrefix) == 0u) {
         result.room.setDoor(line);
       }
@@ -541,9 +282,9 @@ private:
     }
     if(line == cMagicItems) {
       while(true) {
-        line = mComputer.outputLine();
+        line = mComputer.asciiLine();
         if(line.find(cMagicPossiblePrefix) == 0u) {
-          result.room.objects.insert(line.substr(Room::cPrefixSize));
+          result.room.objects.emplace(line.substr(Room::cPrefixSize));
         }
         else {
           break;
@@ -563,20 +304,20 @@ private:
   void gatherObjects(Room &aRoom) {
     for(auto i = aRoom.objects.begin(); i != aRoom.objects.end();) {
       if(mObjects.find(*i) == mObjects.end()) {
-        Intcode<Int> risky = mComputer;
+        Intcode<Int> risky = mComputer.fork();
         std::string command(cCommandTake);
         command += *i;
-        risky.input(command);
-        risky.run();
-        std::string line = risky.outputLine(); // You take the...
-        line = risky.outputLine();
+        risky.inputLine(command);
+        risky.runAscii();
+        std::string_view line = risky.asciiLine(); // You take the...
+        line = risky.asciiLine();
         if(line == cMagicCommand) {
-          mComputer = risky;
+          mComputer = std::move(risky);
           mObjects[*i] = cSafe;
           i = aRoom.objects.erase(i);
         }
         else {
-          mObjects[*i] = line; // danger
+          mObjects[*i] = std::string(line); // danger
           ++i;
         }
       }
@@ -605,6 +346,9 @@ int main(int const argc, char **argv) {
     auto timeSpan = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin);
     std::cout << "duration: " << timeSpan.count() << '\n';
     std::cout << result << '\n';
+#ifdef INTCODE_PROFILE
+    adventure.printProfile();
+#endif
   }
   catch(std::exception const &e) {
     std::cerr << "fail: " << e.what() << std::endl;
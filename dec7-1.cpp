@@ -1,203 +1,73 @@
+#include "intcode.h"
+#include "intcode-batch.h"
+#include "intcode-search.h"
 #include <list>
 #include <limits>
 #include <deque>
 #include <cctype>
+#include <string>
 #include <vector>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <algorithm>
 
-
-class Intcode final {
+// Runs the phase orders of a chunk side by side, an amplifier at a time.
+class Amplifiers final {
 private:
-  static size_t constexpr cInstLengths[] = {1u, 4u, 4u, 2u, 2u, 3u, 3u, 4u, 4u, 1u};
-  static int    const cAdd              =  1;
-  static int    const cMultiply         =  2;
-  static int    const cInput            =  3;
-  static int    const cOutput           =  4;
-  static int    const cJumpIfNot0       =  5;
-  static int    const cJumpIf0          =  6;
-  static int    const cLessThan         =  7;
-  static int    const cEquals           =  8;
-  static int    const cInstCount        = 10;
-  static int    const cHalt             = 99;
-  static int    const cMaskOpcode       = 100;
-  static size_t const cOffsetParameter1 =   1u;
-  static size_t const cOffsetParameter2 =   2u;
-  static size_t const cOffsetResult     =   3u;
+  static int const cInitialInput = 0;
 
-  std::list<int>  mInputs;
-  std::list<int>  mOutputs;
-  std::deque<int> mProgram;
-  std::deque<int> mMemory;
-  size_t          mProgramCounter;
+  IntcodeBatch mBatch;
+  size_t       mLength;
 
 public:
-  Intcode() noexcept = default;
-
-  Intcode(std::ifstream &aIn) noexcept {
-    while(true) {
-      int integer;
-      aIn >> integer;
-      if(!aIn.good()) {
-        break;
-      }
-      mProgram.push_back(integer);
-      aIn.ignore(1u);
-    }
-  }
-
-  Intcode(Intcode const &aOther) noexcept : mProgram(aOther.mProgram) {
-  }
-
-  void input(int const aInput) noexcept {
-    mInputs.push_back(aInput);
-  }
-
-  int output() {
-    return get(mOutputs);
+  Amplifiers(Intcode<Int> const &aMaster, size_t const aLength, size_t const aLaneCount) : mBatch(aMaster, aLaneCount), mLength(aLength) {
   }
 
-  void run() {
-    mMemory = mProgram;
-    mProgramCounter = 0u;
-    while(true) {
-      if(mProgramCounter >= mMemory.size()) {
-        throw std::invalid_argument("Invalid program.");
+  int64_t operator()(std::vector<int> aPhases, size_t const aCount) {
+    size_t laneCount = mBatch.laneCount();
+    std::vector<std::vector<int>> permutations;
+    for(size_t lane = 0u; lane < laneCount; ++lane) {
+      permutations.push_back(aPhases);
+      if(lane + 1u < aCount) {                  // a short chunk repeats its last order in the lanes left
+        std::next_permutation(aPhases.begin(), aPhases.end());
       }
       else { // nothing to do
       }
-      int opcode = mMemory[mProgramCounter] % cMaskOpcode;
-      if(opcode != cHalt && (opcode >= cInstCount || mProgramCounter + cInstLengths[opcode] > mMemory.size())) {
-        throw std::invalid_argument("Invalid program.");
-      }
-      else { // nothing to do
-      }
-    
-      bool jumped = false; 
-      if(opcode == cAdd) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = mMemory[addressParameter1] + mMemory[addressParameter2];
-      }
-      else if(opcode == cMultiply) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = mMemory[addressParameter1] * mMemory[addressParameter2];
-      }
-      else if(opcode == cInput) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        mMemory[addressParameter1] = get(mInputs);
-      }
-      else if(opcode == cOutput) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        mOutputs.push_back(mMemory[addressParameter1]);
-      }
-      else if(opcode == cJumpIfNot0) {
-        size_t addressToCheck = getAddress(cOffsetParameter1);
-        size_t addressOfJUmp = getAddress(cOffsetParameter2);
-        if(mMemory[addressToCheck] != 0) {
-          mProgramCounter = mMemory[addressOfJUmp];
-          jumped = true;
-        }
-        else { // nothing to do
-        }
-      }
-      else if(opcode == cJumpIf0) {
-        size_t addressToCheck = getAddress(cOffsetParameter1);
-        size_t addressOfJUmp = getAddress(cOffsetParameter2);
-        if(mMemory[addressToCheck] == 0) {
-          mProgramCounter = mMemory[addressOfJUmp];
-          jumped = true;
-        }
-        else { // nothing to do
-        }
-      }
-      else if(opcode == cLessThan) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = (mMemory[addressParameter1] < mMemory[addressParameter2] ? 1 : 0);
-      }
-      else if(opcode == cEquals) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = (mMemory[addressParameter1] == mMemory[addressParameter2] ? 1 : 0);
-      }
-      else if(opcode == cHalt) {
-        break;
-      }
-      else { // nothing to do
-      }
-      if(!jumped) {
-        mProgramCounter += cInstLengths[opcode];
+    }
+    std::vector<int64_t> intermediates(laneCount, cInitialInput);
+    for(size_t i = 0u; i < mLength; ++i) {
+      mBatch.start();
+      for(size_t lane = 0u; lane < laneCount; ++lane) {
+        mBatch.input(lane, permutations[lane][i]);
+        mBatch.input(lane, intermediates[lane]);
       }
-      else { // nothing to do
+      mBatch.run();
+      for(size_t lane = 0u; lane < laneCount; ++lane) {
+        intermediates[lane] = mBatch.output(lane);
       }
     }
-  }
-
-private:
-  size_t getAddress(size_t const aOffset) noexcept {
-    int const dividor[] = {0, 100, 1000, 10000};
-    int digit = (mMemory[mProgramCounter] / dividor[aOffset]) % 10;
-    size_t result;
-    if(digit == 0) {
-      result = mMemory[mProgramCounter + aOffset];
-    }
-    else {
-      result = mProgramCounter + aOffset;
-    }
-    return result;
-  }
-  
-  int get(std::list<int> &aList) {
-    if(aList.size() == 0u) {
-      throw std::invalid_argument("List empty.");
-    }
-    else { // nothing to do
-    }
-    int result = aList.front();
-    aList.pop_front();
-    return result;
+    return *std::max_element(intermediates.begin(), intermediates.end());
   }
 };
 
-size_t constexpr Intcode::cInstLengths[];
-
+// Usage: dec7-1 input [amplifiers]
 int main(int const argc, char **argv) {
   size_t const cChainLength = 5u;
-  int const cInitialInput = 0;
+  int const cFirstPhase = 0;
 
   try {
     if(argc == 1) {
       throw std::invalid_argument("Need input filename.");
     }
     std::ifstream in(argv[1]);
-    
-    std::deque<Intcode> chain;
-    chain.emplace_back(in);
-    for(size_t i = 1; i < cChainLength; ++i) {
-      chain.emplace_back(chain[0]);
-    }
-    int phases[cChainLength];
-    int which = 0;
-    std::generate_n(phases, cChainLength, [&which](){ return which++; });
-    int largest = std::numeric_limits<int>::min();
-    do {
-      int intermediate = cInitialInput;
-      for(int i = 0; i < cChainLength; ++i) {
-        chain[i].input(phases[i]);
-        chain[i].input(intermediate);
-        chain[i].run();
-        intermediate = chain[i].output();
-      }
-      largest = std::max(largest, intermediate);
-    } while(std::next_permutation(phases, phases + cChainLength));
+    Intcode<Int> master(in);
+    size_t length = (argc > 2 ? std::stoul(argv[2]) : cChainLength);
+    IntcodePhaseSearch search(length, cFirstPhase);
+    size_t laneCount = search.chunkSize();
+    int64_t largest = search.run([&master, length, laneCount]() {
+      return Amplifiers(master, length, laneCount);
+    });
     std::cout << largest << '\n';
   }
   catch(std::exception const &e) {
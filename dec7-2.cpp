@@ -1,223 +1,89 @@
+#include "intcode.h"
+#include "intcode-pipeline.h"
+#include "intcode-search.h"
 #include <list>
 #include <limits>
+#include <memory>
 #include <deque>
 #include <cctype>
+#include <string>
 #include <vector>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 #include <algorithm>
 
-
-class Intcode final {
+// An amplifier chain with feedback, each amplifier passing its outputs on to the next one. The amplifiers
+// run in turns, each until it waits for input, or pipelined, each on a thread of its own.
+class Chain final {
 private:
-  static size_t constexpr cInstLengths[] = {1u, 4u, 4u, 2u, 2u, 3u, 3u, 4u, 4u, 1u};
-  static int    const cAdd              =  1;
-  static int    const cMultiply         =  2;
-  static int    const cInput            =  3;
-  static int    const cOutput           =  4;
-  static int    const cJumpIfNot0       =  5;
-  static int    const cJumpIf0          =  6;
-  static int    const cLessThan         =  7;
-  static int    const cEquals           =  8;
-  static int    const cInstCount        = 10;
-  static int    const cHalt             = 99;
-  static int    const cMaskOpcode       = 100;
-  static size_t const cOffsetParameter1 =   1u;
-  static size_t const cOffsetParameter2 =   2u;
-  static size_t const cOffsetResult     =   3u;
+  static int const cInitialInput = 0;
 
-  std::list<int>  mInputs;
-  std::list<int>  mOutputs;
-  std::deque<int> mProgram;
-  std::deque<int> mMemory;
-  size_t          mProgramCounter;
+  std::deque<Intcode<Int>>              mChain;
+  std::unique_ptr<IntcodePipeline<Int>> mPipeline;
 
 public:
-  Intcode() noexcept = default;
-
-  Intcode(std::ifstream &aIn) noexcept {
-    while(true) {
-      int integer;
-      aIn >> integer;
-      if(!aIn.good()) {
-        break;
-      }
-      mProgram.push_back(integer);
-      aIn.ignore(1u);
+  Chain(Intcode<Int> const &aMaster, size_t const aLength, bool const aPipelined) {
+    for(size_t i = 0; i < aLength; ++i) {
+      mChain.emplace_back(aMaster);
     }
-  }
-
-  Intcode(Intcode const &aOther) noexcept : mProgram(aOther.mProgram) {
-  }
-
-  void input(int const aInput) noexcept {
-    mInputs.push_back(aInput);
-  }
-
-  int output() {
-    return get(mOutputs);
-  }
-
-  void start() {
-    mInputs.clear();
-    mOutputs.clear();
-    mMemory = mProgram;
-    mProgramCounter = 0u;
-  }
-
-  bool run() {
-    bool result;
-    while(true) {
-      if(mProgramCounter >= mMemory.size()) {
-        throw std::invalid_argument("Invalid program.");
-      }
-      else { // nothing to do
-      }
-      int opcode = mMemory[mProgramCounter] % cMaskOpcode;
-      if(opcode != cHalt && (opcode >= cInstCount || mProgramCounter + cInstLengths[opcode] > mMemory.size())) {
-        throw std::invalid_argument("Invalid program.");
-      }
-      else { // nothing to do
-      }
-    
-      bool jumped = false; 
-      if(opcode == cAdd) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = mMemory[addressParameter1] + mMemory[addressParameter2];
-      }
-      else if(opcode == cMultiply) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = mMemory[addressParameter1] * mMemory[addressParameter2];
-      }
-      else if(opcode == cInput) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        if(mInputs.size() == 0u) {
-          result = false;
-          break;
-        }
-        else {
-          mMemory[addressParameter1] = get(mInputs);
-        }
-      }
-      else if(opcode == cOutput) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        mOutputs.push_back(mMemory[addressParameter1]);
-      }
-      else if(opcode == cJumpIfNot0) {
-        size_t addressToCheck = getAddress(cOffsetParameter1);
-        size_t addressOfJUmp = getAddress(cOffsetParameter2);
-        if(mMemory[addressToCheck] != 0) {
-          mProgramCounter = mMemory[addressOfJUmp];
-          jumped = true;
-        }
-        else { // nothing to do
-        }
-      }
-      else if(opcode == cJumpIf0) {
-        size_t addressToCheck = getAddress(cOffsetParameter1);
-        size_t addressOfJUmp = getAddress(cOffsetParameter2);
-        if(mMemory[addressToCheck] == 0) {
-          mProgramCounter = mMemory[addressOfJUmp];
-          jumped = true;
-        }
-        else { // nothing to do
-        }
-      }
-      else if(opcode == cLessThan) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = (mMemory[addressParameter1] < mMemory[addressParameter2] ? 1 : 0);
-      }
-      else if(opcode == cEquals) {
-        size_t addressParameter1 = getAddress(cOffsetParameter1);
-        size_t addressParameter2 = getAddress(cOffsetParameter2);
-        size_t addressResult     = getAddress(cOffsetResult);
-        mMemory[addressResult] = (mMemory[addressParameter1] == mMemory[addressParameter2] ? 1 : 0);
-      }
-      else if(opcode == cHalt) {
-        result = true;
-        break;
-      }
-      else { // nothing to do
-      }
-      if(!jumped) {
-        mProgramCounter += cInstLengths[opcode];
-      }
-      else { // nothing to do
-      }
+    for(size_t i = 0; i < aLength; ++i) {
+      mChain[i].connect(mChain[(i + 1u) % aLength]);
     }
-    return result;
-  }
-
-private:
-  size_t getAddress(size_t const aOffset) noexcept {
-    int const dividor[] = {0, 100, 1000, 10000};
-    int digit = (mMemory[mProgramCounter] / dividor[aOffset]) % 10;
-    size_t result;
-    if(digit == 0) {
-      result = mMemory[mProgramCounter + aOffset];
+    if(aPipelined) {
+      mPipeline.reset(new IntcodePipeline<Int>(mChain));
     }
-    else {
-      result = mProgramCounter + aOffset;
+    else { // nothing to do
     }
-    return result;
   }
-  
-  int get(std::list<int> &aList) {
-    if(aList.size() == 0u) {
-      throw std::invalid_argument("List empty.");
-    }
-    else { // nothing to do
+
+  int64_t operator()(std::vector<int> aPhases, size_t aCount) {
+    size_t length = mChain.size();
+    int64_t largest = std::numeric_limits<int64_t>::min();
+    for(; aCount > 0u; --aCount) {
+      for(size_t i = 0; i < length; ++i) {
+        mChain[i].start();
+      }
+      for(size_t i = 0; i < length; ++i) {
+        mChain[i].input(aPhases[i]);
+      }
+      mChain.front().input(cInitialInput);
+      if(mPipeline != nullptr) {
+        mPipeline->run();
+      }
+      else {
+        size_t exited = 0u;
+        do {
+          for(size_t i = 0; i < length; ++i) {
+            exited += (mChain[i].run() ? 1u : 0u);
+          }
+        } while(exited < length);
+      }
+      int64_t intermediate = mChain.back().output().toInt();   // the last output waits as input of the first amplifier
+      largest = std::max(largest, intermediate);
+      std::next_permutation(aPhases.begin(), aPhases.end());
     }
-    int result = aList.front();
-    aList.pop_front();
-    return result;
+    return largest;
   }
 };
 
-size_t constexpr Intcode::cInstLengths[];
-
+// Usage: dec7-2 input [amplifiers [pipelined]]
 int main(int const argc, char **argv) {
   size_t const cChainLength = 5u;
-  int const cInitialInput = 0;
+  int const cFirstPhase = 5;
 
   try {
     if(argc == 1) {
       throw std::invalid_argument("Need input filename.");
     }
     std::ifstream in(argv[1]);
-    
-    std::deque<Intcode> chain;
-    chain.emplace_back(in);
-    for(size_t i = 1; i < cChainLength; ++i) {
-      chain.emplace_back(chain[0]);
-    }
-    int phases[cChainLength];
-    int which = 5;
-    std::generate_n(phases, cChainLength, [&which](){ return which++; });
-    int largest = std::numeric_limits<int>::min();
-    do {
-      int intermediate = cInitialInput;
-      for(int i = 0; i < cChainLength; ++i) {
-        chain[i].start();
-        chain[i].input(phases[i]);
-      }
-      size_t exited = 0u;
-      do {
-        for(int i = 0; i < cChainLength; ++i) {
-          chain[i].input(intermediate);
-          exited += (chain[i].run() ? 1u : 0u);
-          intermediate = chain[i].output();
-        }
-      } while(exited < cChainLength);
-      largest = std::max(largest, intermediate);
-    } while(std::next_permutation(phases, phases + cChainLength));
+    Intcode<Int> master(in);
+    size_t length = (argc > 2 ? std::stoul(argv[2]) : cChainLength);
+    bool pipelined = (argc > 3 && std::string(argv[3]) == "pipelined");
+    IntcodePhaseSearch search(length, cFirstPhase);
+    int64_t largest = search.run([&master, length, pipelined]() {
+      return Chain(master, length, pipelined);
+    }, pipelined ? length : 1u);
     std::cout << largest << '\n';
   }
   catch(std::exception const &e) {
@@ -0,0 +1,287 @@
+#ifndef INTCODE_ANALYSIS_H
+#define INTCODE_ANALYSIS_H
+
+#include "intcode-isa.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <utility>
+
+// Static control-flow analysis of an Intcode program as loaded, before it runs.
+//
+// Code is found by following control flow from address 0, from constant jump targets
+// and from immediate operands pointing to valid instructions, which are the return
+// addresses a program stores before calling through the relative base. Jumps to
+// computed targets, like those returns, are noted but not followed. Basic blocks start
+// at address 0, at jump targets, at return addresses and after jumps, input and output.
+//
+// Writes to constant addresses are collected, so self-modified instructions are known.
+// A write through the relative base may hit any cell, the analysis does not bound the
+// relative base. Code behind computed jumps or past a cell holding no instruction may be
+// missed along with its writes. In all these cases every instruction counts as possibly
+// written. As all real programs write through the relative base, translators still check
+// writes into code at run time.
+
+class IntcodeAnalysis final : public IntcodeIsa {
+private:
+  std::vector<int64_t>          mProgram;
+  std::map<size_t, Instruction> mInstructions;
+  std::vector<int64_t>          mOwner;            // start of the instruction covering a cell, -1 for none
+  std::set<size_t>              mLeaders;
+  std::set<size_t>              mJumpTargets;      // constant targets of jumps
+  std::set<size_t>              mReturnAddresses;  // instruction starts the program uses as values
+  std::set<size_t>              mWritten;          // cells written through constant addresses
+  bool                          mComputedJumps  = false;
+  bool                          mRelativeWrites = false;
+  bool                          mBlocked        = false;   // the flow from address 0 ran into a cell holding no instruction
+
+public:
+  IntcodeAnalysis(std::vector<int64_t> const &aProgram) : mProgram(aProgram) {
+    analyse();
+  }
+
+  IntcodeAnalysis(std::ifstream &aIn) {
+    while(true) {
+      std::string number;
+      std::getline(aIn, number, ',');
+      if(aIn.fail()) {
+        break;
+      }
+      else { // nothing to do
+      }
+      if(number.find_first_not_of(" \t\r\n") != std::string::npos) {
+        mProgram.push_back(std::stoll(number));
+      }
+      else { // nothing to do
+      }
+    }
+    analyse();
+  }
+
+  std::vector<int64_t> const &program() const noexcept {
+    return mProgram;
+  }
+
+  // The instructions found, by address.
+  std::map<size_t, Instruction> const &instructions() const noexcept {
+    return mInstructions;
+  }
+
+  std::set<size_t> const &leaders() const noexcept {
+    return mLeaders;
+  }
+
+  // The basic blocks as [begin, end) address ranges. A block ends after a jump or halt, before
+  // the next leader and where no instruction follows.
+  std::vector<std::pair<size_t, size_t>> blocks() const {
+    std::vector<std::pair<size_t, size_t>> result;
+    for(auto leader : mLeaders) {
+      size_t address = leader;
+      auto found = mInstructions.find(address);
+      while(found != mInstructions.end()) {
+        int opcode = found->second.opcode;
+        address += found->second.length;
+        found = (isJump(opcode) || opcode == cHalt || mLeaders.count(address) > 0u ? mInstructions.end() : mInstructions.find(address));
+      }
+      if(address > leader) {
+        result.emplace_back(leader, address);
+      }
+      else { // nothing to do
+      }
+    }
+    return result;
+  }
+
+  std::set<size_t> const &jumpTargets() const noexcept {
+    return mJumpTargets;
+  }
+
+  std::set<size_t> const &returnAddresses() const noexcept {
+    return mReturnAddresses;
+  }
+
+  std::set<size_t> const &writtenCells() const noexcept {
+    return mWritten;
+  }
+
+  bool hasComputedJumps() const noexcept {
+    return mComputedJumps;
+  }
+
+  bool hasRelativeWrites() const noexcept {
+    return mRelativeWrites;
+  }
+
+  // Tells if all code that can run and all cells it writes are known: there are no computed jumps,
+  // no writes through the relative base and the flow from address 0 runs only into instructions.
+  bool isComplete() const noexcept {
+    return !mComputedJumps && !mRelativeWrites && !mBlocked;
+  }
+
+  // Tells if no instruction is ever written, so the program can run without checking its writes.
+  bool isImmutable() const {
+    bool result = isComplete();
+    for(auto i = mWritten.begin(); result && i != mWritten.end(); ++i) {
+      result = !isCode(*i);
+    }
+    return result;
+  }
+
+  // Tells if aAddress belongs to an instruction found.
+  bool isCode(size_t const aAddress) const noexcept {
+    return aAddress < mOwner.size() && mOwner[aAddress] >= 0;
+  }
+
+  bool isWritten(size_t const aAddress) const noexcept {
+    return mWritten.count(aAddress) > 0u;
+  }
+
+  // Tells if the instruction at aAddress may be written: it has a cell written through a constant
+  // address, or the analysis is not complete.
+  bool isSelfModified(size_t const aAddress) const {
+    auto found = mInstructions.find(aAddress);
+    bool result = found != mInstructions.end() && !isComplete();
+    for(size_t i = 0u; found != mInstructions.end() && !result && i < found->second.length; ++i) {
+      result = isWritten(aAddress + i);
+    }
+    return result;
+  }
+
+private:
+  bool inProgram(int64_t const aAddress) const noexcept {
+    return aAddress >= 0 && aAddress < static_cast<int64_t>(mProgram.size());
+  }
+
+  void analyse() {
+    mOwner.assign(mProgram.size(), -1);
+    std::set<size_t> candidates;
+    traverse(0u, candidates, mBlocked);
+    mLeaders.insert(0u);
+    while(!candidates.empty()) {
+      size_t candidate = *candidates.begin();
+      candidates.erase(candidates.begin());
+      bool blocked = false;                                   // candidates may be no code
+      if(mInstructions.find(candidate) == mInstructions.end() && traverse(candidate, candidates, blocked)) {
+        mLeaders.insert(candidate);
+        mReturnAddresses.insert(candidate);
+      }
+      else { // nothing to do
+      }
+    }
+    for(auto const &i : mInstructions) {
+      Instruction const &instruction = i.second;
+      size_t next = i.first + instruction.length;
+      if(isJump(instruction.opcode)) {
+        mLeaders.insert(next);
+        if(instruction.modes[1] != cModeImmediate) {
+          mComputedJumps = true;
+        }
+        else if(inProgram(instruction.operands[1])) {         // other targets fail when jumped to
+          mLeaders.insert(instruction.operands[1]);
+          mJumpTargets.insert(instruction.operands[1]);
+        }
+        else { // nothing to do
+        }
+      }
+      else if(instruction.opcode == cInput || instruction.opcode == cOutput) {
+        mLeaders.insert(next);
+      }
+      else { // nothing to do
+      }
+      if(writes(instruction.opcode)) {
+        size_t last = instruction.length - 2u;
+        if(instruction.modes[last] == cModeImmediate) {     // writing in immediate mode hits the operand cell
+          mWritten.insert(i.first + 1u + last);
+        }
+        else if(instruction.modes[last] == cModeRelative) {
+          mRelativeWrites = true;
+        }
+        else if(instruction.operands[last] >= 0) {             // negative addresses fail when written
+          mWritten.insert(instruction.operands[last]);
+        }
+        else { // nothing to do
+        }
+      }
+      else { // nothing to do
+      }
+    }
+  }
+
+  bool decode(size_t const aAddress, Instruction &aInstruction) const {
+    Word word;
+    bool result = aAddress < mProgram.size() && split(mProgram[aAddress], word) && aAddress + word.length <= mProgram.size();
+    if(result) {
+      aInstruction.opcode = word.opcode;
+      aInstruction.length = word.length;
+      for(size_t i = 0u; i + 1u < word.length; ++i) {
+        aInstruction.modes[i] = word.modes[i];
+        aInstruction.operands[i] = mProgram[aAddress + 1u + i];
+      }
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+  // Follows the control flow from aEntry as long as it finds valid instructions
+  // not overlapping the ones known so far. Collects immediate operands as possible entries.
+  // Sets aBlocked if the flow ran into a cell holding no such instruction.
+  bool traverse(size_t const aEntry, std::set<size_t> &aCandidates, bool &aBlocked) {
+    std::vector<size_t> work{aEntry};
+    bool result = false;
+    while(!work.empty()) {
+      size_t address = work.back();
+      work.pop_back();
+      while(mInstructions.find(address) == mInstructions.end()) {
+        Instruction instruction;
+        if(!decode(address, instruction)) {
+          aBlocked = true;
+          break;
+        }
+        else { // nothing to do
+        }
+        bool free = true;
+        for(size_t i = 0u; free && i < instruction.length; ++i) {
+          free = mOwner[address + i] < 0;
+        }
+        if(!free) {
+          aBlocked = true;
+          break;
+        }
+        else { // nothing to do
+        }
+        result = true;
+        mInstructions[address] = instruction;
+        for(size_t i = 0u; i < instruction.length; ++i) {
+          mOwner[address + i] = address;
+        }
+        for(size_t i = 0u; i + 1u < instruction.length; ++i) {
+          if(instruction.modes[i] == cModeImmediate && inProgram(instruction.operands[i])) {
+            aCandidates.insert(instruction.operands[i]);
+          }
+          else { // nothing to do
+          }
+        }
+        bool jump = isJump(instruction.opcode);
+        if(jump && instruction.modes[1] == cModeImmediate && inProgram(instruction.operands[1])) {
+          work.push_back(instruction.operands[1]);
+        }
+        else { // nothing to do
+        }
+        bool always = jump && instruction.modes[0] == cModeImmediate && (instruction.operands[0] != 0) == (instruction.opcode == cJumpIfNot0);
+        if(always || instruction.opcode == cHalt) {
+          break;
+        }
+        else { // nothing to do
+        }
+        address += instruction.length;
+      }
+    }
+    return result;
+  }
+};
+
+#endif
@@ -0,0 +1,463 @@
+#ifndef INTCODE_BATCH_H
+#define INTCODE_BATCH_H
+
+#include "intcode.h"
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+
+// Runs many instances of one program side by side, like a program tried for each permutation of its
+// inputs. Memory is laid out address major: the cells of an address for all lanes lie next to each
+// other, so an instruction all lanes run together is a loop over contiguous cells the compiler can
+// vectorize. Like IntcodeMemory it is paged, a page holding the rows of cPageSize addresses is
+// allocated when first written, so far addresses cost a page and not the rows up to them.
+// Lanes at the same program counter and relative base form a group and run in lockstep.
+// A jump or relative base change going different ways splits the group. The group with the lowest
+// program counter runs first, so the others wait where lanes usually meet again, and groups meeting
+// merge. Where the lanes of a group hold different code at their program counter, the group splits
+// into groups of the lanes holding the same code for that instruction. Cells must fit into int64_t.
+
+class IntcodeBatch final : private IntcodeIsa {
+private:
+  static size_t constexpr cPageBits     = IntcodeMemory<int64_t>::cPageBits;
+  static size_t constexpr cPageSize     = IntcodeMemory<int64_t>::cPageSize;   // addresses per page
+  static size_t constexpr cPageMask     = IntcodeMemory<int64_t>::cPageMask;
+  static size_t constexpr cMaxSize      = IntcodeMemory<int64_t>::cMaxPages * cPageSize;   // cells per lane
+
+  struct Group final {
+    size_t              programCounter;
+    int64_t             relativeBase;
+    std::vector<size_t> lanes;               // ascending
+    bool                waiting = false;     // for input, until the next run()
+  };
+
+  struct Lane final {
+    std::vector<int64_t> inputs;
+    size_t               inputPosition = 0u;
+    std::vector<int64_t> outputs;
+    size_t               outputPosition = 0u;
+    bool                 halted = false;
+  };
+
+  // An operand as seen by all lanes of a group: a row of cells or the same immediate value.
+  struct Operand final {
+    int64_t const *row;                      // nullptr for immediate
+    int64_t        value;
+  };
+
+  std::vector<int64_t>              mProgram;
+  size_t                            mLaneCount;
+  std::vector<std::vector<int64_t>> mPages;      // mPages[page][offset * mLaneCount + lane], empty until written
+  std::vector<int64_t>              mZeroRow;    // read for addresses of pages never written
+  std::vector<bool>                 mWritten;    // pages written since start()
+  size_t                            mTop = 0u;   // past the highest address written
+  std::vector<Group>                mGroups;
+  std::vector<Lane>                 mLanes;
+  size_t                            mSteps = 0u;
+  size_t                            mLaneSteps = 0u;
+
+public:
+  IntcodeBatch(std::vector<int64_t> const &aProgram, size_t const aLaneCount) : mProgram(aProgram), mLaneCount(aLaneCount) {
+    start();
+  }
+
+  // Takes the program of aMachine.
+  template<typename tNumber>
+  IntcodeBatch(Intcode<tNumber> const &aMachine, size_t const aLaneCount) : mLaneCount(aLaneCount) {
+    for(auto const &cell : aMachine.program()) {
+      if(!fitsInt64(cell)) {
+        throw std::invalid_argument("Number does not fit into a batch.");
+      }
+      else { // nothing to do
+      }
+      mProgram.push_back(toInt64(cell));
+    }
+    start();
+  }
+
+  size_t laneCount() const noexcept {
+    return mLaneCount;
+  }
+
+  // Instructions run by groups and by single lanes, their ratio tells how much lockstep saved.
+  size_t stepCount() const noexcept {
+    return mSteps;
+  }
+
+  size_t laneStepCount() const noexcept {
+    return mLaneSteps;
+  }
+
+  // Keeps the pages of the program and restores only those written since, pages after it are dropped.
+  void start() {
+    size_t size = mProgram.size();
+    size_t pages = (size + cPageMask) >> cPageBits;
+    mPages.resize(std::min(mPages.size(), pages));
+    mWritten.resize(mPages.size());
+    mZeroRow.assign(mLaneCount, 0);
+    for(size_t page = 0u; page < pages; ++page) {
+      if(page >= mPages.size() || mPages[page].empty() || mWritten[page]) {
+        size_t begin = page << cPageBits;
+        size_t end = std::min(size, begin + cPageSize);
+        for(size_t address = begin; address < end; ++address) {
+          std::fill_n(writableRow(address), mLaneCount, mProgram[address]);
+        }
+        for(size_t address = end; address < std::min(mTop, begin + cPageSize); ++address) {
+          std::fill_n(writableRow(address), mLaneCount, 0);
+        }
+      }
+      else { // nothing to do
+      }
+    }
+    mWritten.assign(mPages.size(), false);
+    mTop = size;
+    mLanes.assign(mLaneCount, Lane());
+    mGroups.clear();
+    Group all{0u, 0, std::vector<size_t>(mLaneCount)};
+    for(size_t lane = 0u; lane < mLaneCount; ++lane) {
+      all.lanes[lane] = lane;
+    }
+    if(mLaneCount > 0u) {
+      mGroups.push_back(std::move(all));
+    }
+    else { // nothing to do
+    }
+  }
+
+  void poke(size_t const aLane, size_t const aAddress, int64_t const aValue) {
+    writableRow(aAddress)[aLane] = aValue;
+  }
+
+  int64_t peek(size_t const aLane, size_t const aAddress) const noexcept {
+    return row(aAddress)[aLane];
+  }
+
+  void input(size_t const aLane, int64_t const aValue) {
+    mLanes[aLane].inputs.push_back(aValue);
+  }
+
+  bool hasOutput(size_t const aLane) const noexcept {
+    return mLanes[aLane].outputPosition < mLanes[aLane].outputs.size();
+  }
+
+  int64_t output(size_t const aLane) {
+    Lane &lane = mLanes[aLane];
+    if(lane.outputPosition == lane.outputs.size()) {
+      throw std::invalid_argument("List empty.");
+    }
+    else { // nothing to do
+    }
+    return lane.outputs[lane.outputPosition++];
+  }
+
+  bool halted(size_t const aLane) const noexcept {
+    return mLanes[aLane].halted;
+  }
+
+  // Runs until every lane halts, returning true, or some wait for input, returning false.
+  bool run() {
+    std::vector<Group> groups;
+    groups.swap(mGroups);
+    for(auto &group : groups) {
+      group.waiting = false;
+      add(std::move(group));
+    }
+    while(true) {
+      size_t next = mGroups.size();
+      size_t stop = cMaxSize;
+      for(size_t i = 0u; i < mGroups.size(); ++i) {
+        if(mGroups[i].waiting) { // nothing to do
+        }
+        else if(next == mGroups.size() || mGroups[i].programCounter < mGroups[next].programCounter) {
+          stop = (next == mGroups.size() ? stop : mGroups[next].programCounter);
+          next = i;
+        }
+        else {
+          stop = std::min(stop, mGroups[i].programCounter);
+        }
+      }
+      if(next == mGroups.size()) {
+        break;
+      }
+      else { // nothing to do
+      }
+      Group group = std::move(mGroups[next]);
+      mGroups[next] = std::move(mGroups.back());
+      mGroups.pop_back();
+      step(std::move(group), stop);
+    }
+    return mGroups.empty();
+  }
+
+private:
+  // The cells of aAddress for all lanes. Rows stay where they are when other pages are allocated.
+  int64_t const *row(size_t const aAddress) const noexcept {
+    size_t page = aAddress >> cPageBits;
+    return page < mPages.size() && !mPages[page].empty() ? &mPages[page][(aAddress & cPageMask) * mLaneCount] : mZeroRow.data();
+  }
+
+  int64_t *writableRow(size_t const aAddress) {
+    if(aAddress >= cMaxSize) {
+      throw std::invalid_argument("Invalid address.");
+    }
+    else { // nothing to do
+    }
+    size_t page = aAddress >> cPageBits;
+    if(page >= mPages.size()) {
+      mPages.resize(page + 1u);
+      mWritten.resize(page + 1u);
+    }
+    else { // nothing to do
+    }
+    if(mPages[page].empty()) {
+      mPages[page].assign(cPageSize * mLaneCount, 0);
+    }
+    else { // nothing to do
+    }
+    mWritten[page] = true;
+    mTop = std::max(mTop, aAddress + 1u);
+    return &mPages[page][(aAddress & cPageMask) * mLaneCount];
+  }
+
+  // Puts aGroup back, merged into a group at the same place if there is one.
+  void add(Group &&aGroup) {
+    auto same = std::find_if(mGroups.begin(), mGroups.end(), [&aGroup](Group const &aOther) {
+      return aOther.programCounter == aGroup.programCounter && aOther.relativeBase == aGroup.relativeBase && aOther.waiting == aGroup.waiting;
+    });
+    if(same != mGroups.end()) {
+      std::vector<size_t> lanes;
+      lanes.reserve(same->lanes.size() + aGroup.lanes.size());
+      std::merge(same->lanes.begin(), same->lanes.end(), aGroup.lanes.begin(), aGroup.lanes.end(), std::back_inserter(lanes));
+      same->lanes.swap(lanes);
+    }
+    else {
+      mGroups.push_back(std::move(aGroup));
+    }
+  }
+
+  // Regroups the lanes of aGroup, in order, by their new program counter and relative base.
+  void split(Group const &aGroup, std::vector<size_t> const &aProgramCounters, std::vector<int64_t> const &aRelativeBases) {
+    std::vector<Group> groups;
+    for(size_t i = 0u; i < aGroup.lanes.size(); ++i) {
+      auto same = std::find_if(groups.begin(), groups.end(), [&](Group const &aOther) {
+        return aOther.programCounter == aProgramCounters[i] && aOther.relativeBase == aRelativeBases[i];
+      });
+      if(same == groups.end()) {
+        groups.push_back(Group{aProgramCounters[i], aRelativeBases[i], {}});
+        same = groups.end() - 1;
+      }
+      else { // nothing to do
+      }
+      same->lanes.push_back(aGroup.lanes[i]);
+    }
+    for(auto &group : groups) {
+      add(std::move(group));
+    }
+  }
+
+  template<typename tFunction>
+  void forLanes(Group const &aGroup, tFunction const &aFunction) {
+    if(aGroup.lanes.size() == mLaneCount) {
+      for(size_t lane = 0u; lane < mLaneCount; ++lane) {
+        aFunction(lane);
+      }
+    }
+    else {
+      for(auto lane : aGroup.lanes) {
+        aFunction(lane);
+      }
+    }
+    ++mSteps;
+    mLaneSteps += aGroup.lanes.size();
+  }
+
+  // Tells if the aLength cells from aAddress hold the same values in every lane of aGroup.
+  bool uniform(Group const &aGroup, size_t const aAddress, size_t const aLength) const noexcept {
+    bool result = true;
+    for(size_t address = aAddress; result && address < aAddress + aLength; ++address) {
+      int64_t const *cells = row(address);
+      int64_t first = cells[aGroup.lanes.front()];
+      for(auto lane : aGroup.lanes) {
+        result = result && cells[lane] == first;
+      }
+    }
+    return result;
+  }
+
+  // Runs the lanes of aGroup, which hold different code at their program counter, in groups by that code.
+  void diverge(Group &&aGroup, size_t const aStop) {
+    size_t pc = aGroup.programCounter;
+    std::vector<Group> groups;
+    for(auto lane : aGroup.lanes) {
+      auto same = std::find_if(groups.begin(), groups.end(), [this, pc, lane](Group const &aOther) {
+        bool result = true;
+        for(size_t address = pc; result && address < pc + cMaxInstLength; ++address) {
+          result = row(address)[lane] == row(address)[aOther.lanes.front()];
+        }
+        return result;
+      });
+      if(same == groups.end()) {
+        groups.push_back(Group{pc, aGroup.relativeBase, {}});
+        same = groups.end() - 1;
+      }
+      else { // nothing to do
+      }
+      same->lanes.push_back(lane);
+    }
+    for(auto &group : groups) {
+      step(std::move(group), aStop);
+    }
+  }
+
+  // Negative addresses wrap around as in Intcode, so they read 0 and fail when written.
+  static size_t address(int64_t const aOperand, int const aMode, int64_t const aRelativeBase) noexcept {
+    return static_cast<size_t>(aMode == cModeRelative ? aRelativeBase + aOperand : aOperand);
+  }
+
+  // Runs aGroup from its program counter until control flow may change or it reaches aStop, where
+  // another group waits to merge.
+  void step(Group &&aGroup, size_t const aStop) {
+    size_t first = aGroup.lanes.front();
+    while(true) {
+      size_t pc = aGroup.programCounter;
+      Word word{};
+      bool valid = IntcodeIsa::split(row(pc)[first], word);
+      if(!uniform(aGroup, pc, 1u) || (valid && !uniform(aGroup, pc, word.length))) {
+        diverge(std::move(aGroup), aStop);
+        break;
+      }
+      else if(!valid) {
+        throw std::invalid_argument("Invalid program.");
+      }
+      else if(word.opcode == cHalt) {
+        for(auto lane : aGroup.lanes) {
+          mLanes[lane].halted = true;
+        }
+        break;
+      }
+      else { // nothing to do
+      }
+      int opcode = word.opcode;
+      size_t length = word.length;
+      int64_t const relativeBase = aGroup.relativeBase;
+      // Addresses are resolved only for the operands used, like the interpreter does.
+      auto operand = [this, pc, first, relativeBase, &word](size_t const aIndex) {
+        int64_t value = row(pc + 1u + aIndex)[first];
+        return word.modes[aIndex] == cModeImmediate ? Operand{nullptr, value} : Operand{row(address(value, word.modes[aIndex], relativeBase)), 0};
+      };
+      // Writes in immediate mode hit the operand cell, as in Intcode.
+      auto target = [this, pc, first, relativeBase, &word](size_t const aIndex) {
+        size_t cell = pc + 1u + aIndex;
+        return writableRow(word.modes[aIndex] == cModeImmediate ? cell : address(row(cell)[first], word.modes[aIndex], relativeBase));
+      };
+      if(opcode == cAdd) {
+        binary(aGroup, operand(0u), operand(1u), target(2u), [](int64_t const aLeft, int64_t const aRight) { return aLeft + aRight; });
+      }
+      else if(opcode == cMultiply) {
+        binary(aGroup, operand(0u), operand(1u), target(2u), [](int64_t const aLeft, int64_t const aRight) { return aLeft * aRight; });
+      }
+      else if(opcode == cLessThan) {
+        binary(aGroup, operand(0u), operand(1u), target(2u), [](int64_t const aLeft, int64_t const aRight) { return aLeft < aRight ? int64_t(1) : int64_t(0); });
+      }
+      else if(opcode == cEquals) {
+        binary(aGroup, operand(0u), operand(1u), target(2u), [](int64_t const aLeft, int64_t const aRight) { return aLeft == aRight ? int64_t(1) : int64_t(0); });
+      }
+      else if(opcode == cInput) {
+        int64_t *cells = nullptr;                 // resolved for the first lane fed
+        Group waiting{pc, aGroup.relativeBase, {}, true};
+        std::vector<size_t> fed;
+        for(auto lane : aGroup.lanes) {
+          Lane &state = mLanes[lane];
+          if(state.inputPosition < state.inputs.size()) {
+            cells = (cells == nullptr ? target(0u) : cells);
+            cells[lane] = state.inputs[state.inputPosition++];
+            fed.push_back(lane);
+          }
+          else {
+            waiting.lanes.push_back(lane);
+          }
+        }
+        ++mSteps;
+        mLaneSteps += fed.size();
+        if(!waiting.lanes.empty()) {
+          add(std::move(waiting));
+        }
+        else { // nothing to do
+        }
+        if(!fed.empty()) {
+          add(Group{pc + length, aGroup.relativeBase, std::move(fed)});
+        }
+        else { // nothing to do
+        }
+        break;
+      }
+      else if(opcode == cOutput) {
+        Operand value = operand(0u);
+        forLanes(aGroup, [this, &value](size_t const aLane) {
+          mLanes[aLane].outputs.push_back(value.row != nullptr ? value.row[aLane] : value.value);
+        });
+        aGroup.programCounter += length;
+        add(std::move(aGroup));
+        break;
+      }
+      else {
+        // Jumps and relative base changes, the lanes may go separate ways.
+        std::vector<size_t> programCounters(aGroup.lanes.size(), pc + length);
+        std::vector<int64_t> relativeBases(aGroup.lanes.size(), aGroup.relativeBase);
+        Operand value = operand(0u);
+        for(size_t i = 0u; i < aGroup.lanes.size(); ++i) {
+          size_t lane = aGroup.lanes[i];
+          int64_t parameter = (value.row != nullptr ? value.row[lane] : value.value);
+          if(opcode == cRelativeBase) {
+            relativeBases[i] += parameter;
+          }
+          else if((parameter != 0) == (opcode == cJumpIfNot0)) {
+            Operand jumpTarget = operand(1u);
+            int64_t destination = (jumpTarget.row != nullptr ? jumpTarget.row[lane] : jumpTarget.value);
+            if(destination < 0) {
+              throw std::invalid_argument("Invalid address.");
+            }
+            else { // nothing to do
+            }
+            programCounters[i] = destination;
+          }
+          else { // nothing to do
+          }
+        }
+        ++mSteps;
+        mLaneSteps += aGroup.lanes.size();
+        split(aGroup, programCounters, relativeBases);
+        break;
+      }
+      aGroup.programCounter += length;
+      if(aGroup.programCounter == aStop) {
+        add(std::move(aGroup));
+        break;
+      }
+      else { // nothing to do
+      }
+    }
+  }
+
+  template<typename tOperation>
+  void binary(Group const &aGroup, Operand const aLeft, Operand const aRight, int64_t *aResult, tOperation const &aOperation) {
+    int64_t *result = aResult;
+    if(aLeft.row != nullptr && aRight.row != nullptr) {
+      forLanes(aGroup, [&](size_t const aLane) { result[aLane] = aOperation(aLeft.row[aLane], aRight.row[aLane]); });
+    }
+    else if(aLeft.row != nullptr) {
+      forLanes(aGroup, [&](size_t const aLane) { result[aLane] = aOperation(aLeft.row[aLane], aRight.value); });
+    }
+    else if(aRight.row != nullptr) {
+      forLanes(aGroup, [&](size_t const aLane) { result[aLane] = aOperation(aLeft.value, aRight.row[aLane]); });
+    }
+    else {
+      int64_t value = aOperation(aLeft.value, aRight.value);
+      forLanes(aGroup, [&](size_t const aLane) { result[aLane] = value; });
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,69 @@
+#include "intcode.h"
+#include "intcode-jit.h"
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+// Runs an Intcode program from start as many times as requested, feeding it
+// the given inputs, and reports the time taken.
+// Usage: intcode-bench program.in [repeat] [input...]
+// Build with -DINTCODE_NATIVE=name and the output of intcode2cpp to run the
+// translated blocks instead of the interpreter, or with -DINTCODE_JIT to compile
+// hot blocks at run time. Build with -DINTCODE_PROFILE to print where the
+// interpreter spent its instructions.
+
+#ifdef INTCODE_NATIVE
+extern IntcodeNative<Int> const INTCODE_NATIVE;
+#endif
+
+int main(int const argc, char **argv) {
+  try {
+    if(argc == 1) {
+      throw std::invalid_argument("Need input filename.");
+    }
+    std::ifstream in(argv[1]);
+    size_t repeat = (argc > 2 ? std::stoul(argv[2]) : 1u);
+    std::vector<int64_t> inputs;
+    for(int i = 3; i < argc; ++i) {
+      inputs.push_back(std::stoll(argv[i]));
+    }
+
+    Intcode<Int> computer(in);
+#ifdef INTCODE_NATIVE
+    computer.attach(INTCODE_NATIVE);
+#endif
+#ifdef INTCODE_JIT
+    IntcodeJit jit;
+    computer.attach(jit.compiler());
+#endif
+    int64_t last = 0;
+    bool halted = false;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for(size_t i = 0u; i < repeat; ++i) {
+      computer.start();
+      for(auto input : inputs) {
+        computer.input(input);
+      }
+      halted = computer.run();
+      while(computer.hasOutput()) {
+        last = computer.output();
+      }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto timeSpan = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin);
+    std::cout << "duration: " << timeSpan.count() << '\n';
+    std::cout << "per run: " << timeSpan.count() / repeat << '\n';
+    std::cout << (halted ? "halted" : "waiting for input") << ", last output: " << last << '\n';
+#ifdef INTCODE_PROFILE
+    computer.profile().print(std::cout);
+#endif
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,113 @@
+#ifndef INTCODE_IMAGE_H
+#define INTCODE_IMAGE_H
+
+#include "intcode.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// A program stored as binary image: a magic word, the cell count and the cells as
+// int64_t, all in the byte order of the machine writing it. Loading maps the file and
+// converts the cells in one pass, so machines start without parsing any text.
+// intcode2image.cpp converts the text inputs. Programs with cells not fitting into
+// int64_t have no image and stay text.
+
+class IntcodeImage final {
+private:
+  static uint64_t constexpr cMagic      = 0x31474d4943544e49u;   // "INTCIMG1" when little endian
+  static size_t   constexpr cHeaderSize = 2u * sizeof(uint64_t);
+
+  void          *mMapping = MAP_FAILED;
+  size_t         mLength  = 0u;
+  int64_t const *mCells   = nullptr;
+  size_t         mSize    = 0u;
+
+public:
+  IntcodeImage(std::string const &aFilename) {
+    int file = open(aFilename.c_str(), O_RDONLY);
+    if(file < 0) {
+      throw std::invalid_argument("Can not open " + aFilename);
+    }
+    else { // nothing to do
+    }
+    struct stat status;
+    if(fstat(file, &status) == 0 && static_cast<size_t>(status.st_size) >= cHeaderSize) {
+      mLength = status.st_size;
+      mMapping = mmap(nullptr, mLength, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    else { // nothing to do
+    }
+    close(file);
+    if(mMapping == MAP_FAILED) {
+      throw std::invalid_argument("Can not map " + aFilename);
+    }
+    else { // nothing to do
+    }
+    uint64_t const *header = static_cast<uint64_t const*>(mMapping);
+    if(header[0] != cMagic || header[1] != (mLength - cHeaderSize) / sizeof(int64_t) || (mLength - cHeaderSize) % sizeof(int64_t) != 0u) {
+      munmap(mMapping, mLength);
+      throw std::invalid_argument("Invalid image.");
+    }
+    else { // nothing to do
+    }
+    mCells = reinterpret_cast<int64_t const*>(header + 2u);
+    mSize  = header[1];
+  }
+
+  IntcodeImage(IntcodeImage const &) = delete;
+  IntcodeImage &operator=(IntcodeImage const &) = delete;
+
+  ~IntcodeImage() {
+    munmap(mMapping, mLength);
+  }
+
+  int64_t const *cells() const noexcept {
+    return mCells;
+  }
+
+  size_t size() const noexcept {
+    return mSize;
+  }
+
+  template<typename tNumber>
+  Intcode<tNumber> machine() const {
+    return Intcode<tNumber>(mCells, mSize);
+  }
+
+  // Tells if aFilename starts like an image, and so is not a text program.
+  static bool isImage(std::string const &aFilename) {
+    std::ifstream in(aFilename, std::ios::binary);
+    uint64_t magic = 0u;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    return in.good() && magic == cMagic;
+  }
+
+  static void write(std::ostream &aOut, std::vector<int64_t> const &aCells) {
+    uint64_t header[] = { cMagic, aCells.size() };
+    aOut.write(reinterpret_cast<char const*>(header), sizeof(header));
+    aOut.write(reinterpret_cast<char const*>(aCells.data()), aCells.size() * sizeof(int64_t));
+  }
+};
+
+// Loads aFilename mapping it if it is an image, or parsing it as text otherwise.
+template<typename tNumber>
+Intcode<tNumber> loadIntcode(std::string const &aFilename) {
+  Intcode<tNumber> result;
+  if(IntcodeImage::isImage(aFilename)) {
+    result = IntcodeImage(aFilename).machine<tNumber>();
+  }
+  else {
+    std::ifstream in(aFilename);
+    result = Intcode<tNumber>(in);
+  }
+  return result;
+}
+
+#endif
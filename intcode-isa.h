@@ -0,0 +1,78 @@
+#ifndef INTCODE_ISA_H
+#define INTCODE_ISA_H
+
+#include <cstddef>
+#include <cstdint>
+
+// The Intcode instruction set: opcodes, instruction lengths, operand modes and how an instruction
+// word splits into them. The interpreter, the JIT, the batch interpreter and the static analysis
+// derive from it, so they agree on what a word means.
+
+class IntcodeIsa {
+public:
+  static size_t constexpr cInstLengths[] = {1u, 4u, 4u, 2u, 2u, 3u, 3u, 4u, 4u, 2u};
+  static int    constexpr cAdd              =  1;
+  static int    constexpr cMultiply         =  2;
+  static int    constexpr cInput            =  3;
+  static int    constexpr cOutput           =  4;
+  static int    constexpr cJumpIfNot0       =  5;
+  static int    constexpr cJumpIf0          =  6;
+  static int    constexpr cLessThan         =  7;
+  static int    constexpr cEquals           =  8;
+  static int    constexpr cRelativeBase     =  9;
+  static int    constexpr cInstCount        = 10;
+  static int    constexpr cHalt             = 99;
+  static int    constexpr cMaskOpcode       = 100;
+  static int    constexpr cMaskMode         =  10;
+  static size_t constexpr cMaxOperands      =   3u;
+  static size_t constexpr cMaxInstLength    =   4u;
+  static int    constexpr cModePosition     =   0;
+  static int    constexpr cModeImmediate    =   1;
+  static int    constexpr cModeRelative     =   2;
+
+  // An instruction word split up, the modes are those of the length - 1 operands.
+  struct Word final {
+    int    opcode;
+    int    modes[cMaxOperands];
+    size_t length;
+  };
+
+  // An instruction with its operands as they are in memory.
+  struct Instruction final {
+    int     opcode;
+    int     modes[cMaxOperands];
+    int64_t operands[cMaxOperands];
+    size_t  length;
+  };
+
+  // Splits aWord into aResult. Returns false if it is no instruction: not positive, of an unknown
+  // opcode or with an unknown mode. Mode digits beyond the operands are ignored, like the interpreter does.
+  static bool split(int64_t const aWord, Word &aResult) noexcept {
+    int64_t opcode = aWord % cMaskOpcode;
+    bool result = aWord > 0 && (opcode == cHalt || (opcode > 0 && opcode < cInstCount));
+    if(result) {
+      aResult.opcode = static_cast<int>(opcode);
+      aResult.length = (opcode == cHalt ? 1u : cInstLengths[opcode]);
+      int64_t modes = aWord / cMaskOpcode;
+      for(size_t i = 0u; result && i + 1u < aResult.length; ++i) {
+        aResult.modes[i] = static_cast<int>(modes % cMaskMode);
+        modes /= cMaskMode;
+        result = aResult.modes[i] <= cModeRelative;
+      }
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+  static bool isJump(int const aOpcode) noexcept {
+    return aOpcode == cJumpIfNot0 || aOpcode == cJumpIf0;
+  }
+
+  // Tells if instructions of aOpcode write their last operand.
+  static bool writes(int const aOpcode) noexcept {
+    return aOpcode == cAdd || aOpcode == cMultiply || aOpcode == cLessThan || aOpcode == cEquals || aOpcode == cInput;
+  }
+};
+
+#endif
@@ -0,0 +1,427 @@
+#ifndef INTCODE_JIT_H
+#define INTCODE_JIT_H
+
+#include "intcode.h"
+#include <map>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include <initializer_list>
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define INTCODE_JIT_X86_64
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+// Compiles the straight-line blocks an Intcode<Int> runs often into x86-64 machine code
+// at run time. Attach it to machines with computer.attach(jit.compiler()) before start(),
+// it must outlive them. Where the machine is not x86-64 with the System V ABI nothing gets
+// compiled and the interpreter does all the work.
+//
+// A block ends after a jump, or before input, output, halt and anything invalid, which
+// are left to the interpreter. Generated code keeps the relative base in a register and
+// reaches memory through the Native view, so a write into code makes the block return
+// and the interpreter take over that code for good. Compiled blocks are kept by start
+// address and cell contents, so machines sharing a JIT share code and a restarted machine
+// finds its blocks again. Code is copied into chunks mapped both writable and executable,
+// where the system refuses those nothing gets compiled. A JIT must not be shared between threads.
+
+class IntcodeJit final : private IntcodeIsa {
+private:
+  using Native      = Intcode<Int>::Native;
+  using NativeBlock = Intcode<Int>::NativeBlock;
+
+  static_assert(std::is_standard_layout<Native>::value && sizeof(Int) == sizeof(int64_t), "Generated code reads Native and the cells directly.");
+
+  static size_t const cMaxBlockLength   = 256u;  // instructions
+  static size_t constexpr cChunkSize    = 1u << 20u;
+  static size_t constexpr cCodeAlignment =  16u;
+  static int64_t const cContinue        =   0;   // results of write()
+  static int64_t const cLeaveAfter      =   1;
+  static int64_t const cLeaveBefore     =   2;
+  static uint32_t const cRelativeBaseField  = offsetof(Native, relativeBase);
+  static uint32_t const cPagesField         = offsetof(Native, pages);
+  static uint32_t const cWritablePagesField = offsetof(Native, writablePages);
+  static uint32_t const cPageCountField     = offsetof(Native, pageCount);
+  static uint32_t const cSizeField          = offsetof(Native, size);
+  static uint32_t const cCodeField          = offsetof(Native, code);
+  static uint32_t const cCodeSizeField      = offsetof(Native, codeSize);
+  static uint32_t const cEntriesField       = offsetof(Native, entries);
+  static uint32_t const cEntryCountField    = offsetof(Native, entryCount);
+
+  struct Compiled final {
+    std::vector<int64_t> cells;
+    NativeBlock          function;
+  };
+
+  std::map<size_t, std::vector<Compiled>> mCompiled;
+  std::vector<std::pair<void*, size_t>>   mMappings;
+  uint8_t                                *mFree     = nullptr;   // unused part of the last mapping
+  size_t                                  mFreeSize = 0u;
+  std::vector<uint8_t>                    mAssembly;   // the block being assembled
+  std::vector<size_t>                     mExits;      // rel32 fields in mAssembly to point to the epilogue
+
+public:
+  IntcodeJit() = default;
+  IntcodeJit(IntcodeJit const &) = delete;
+  IntcodeJit &operator=(IntcodeJit const &) = delete;
+
+  ~IntcodeJit() {
+#ifdef INTCODE_JIT_X86_64
+    for(auto const &mapping : mMappings) {
+      munmap(mapping.first, mapping.second);
+    }
+#endif
+  }
+
+  Intcode<Int>::NativeCompiler compiler() {
+    return [this](IntcodeMemory<Int> const &aMemory, size_t const aBegin, size_t &aEnd) {
+      return compile(aMemory, aBegin, aEnd);
+    };
+  }
+
+  NativeBlock compile(IntcodeMemory<Int> const &aMemory, size_t const aBegin, size_t &aEnd) {
+    std::vector<Instruction> block;
+    size_t end = aBegin;
+    Instruction instruction;
+    while(block.size() < cMaxBlockLength && decode(aMemory, end, instruction)) {
+      block.push_back(instruction);
+      end += instruction.length;
+      if(instruction.opcode == cJumpIfNot0 || instruction.opcode == cJumpIf0) {
+        break;
+      }
+      else { // nothing to do
+      }
+    }
+    NativeBlock result = nullptr;
+    if(!block.empty()) {
+      std::vector<int64_t> cells;
+      for(size_t i = aBegin; i < end; ++i) {
+        cells.push_back(aMemory.read(i).toInt());
+      }
+      std::vector<Compiled> &variants = mCompiled[aBegin];
+      for(auto const &variant : variants) {
+        if(variant.cells == cells) {
+          result = variant.function;
+        }
+        else { // nothing to do
+        }
+      }
+      if(result == nullptr) {
+        result = install(assemble(aBegin, block));
+        if(result != nullptr) {
+          variants.push_back(Compiled{cells, result});
+        }
+        else { // nothing to do
+        }
+      }
+      else { // nothing to do
+      }
+      aEnd = end;
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+private:
+  // Mirrors the decoding of the interpreter, but accepts only what a block may contain.
+  static bool decode(IntcodeMemory<Int> const &aMemory, size_t const aAddress, Instruction &aInstruction) {
+    Word word;
+    bool result = aAddress < aMemory.size() && split(aMemory.read(aAddress).toInt(), word)
+               && word.opcode != cInput && word.opcode != cOutput && word.opcode != cHalt;
+    if(result) {
+      aInstruction.opcode = word.opcode;
+      aInstruction.length = word.length;
+      for(size_t i = 0u; i + 1u < word.length; ++i) {
+        aInstruction.modes[i] = word.modes[i];
+        aInstruction.operands[i] = aMemory.read(aAddress + 1u + i).toInt();
+        if(aInstruction.modes[i] == cModeImmediate && i == cMaxOperands - 1u) {
+          aInstruction.modes[i] = cModePosition;    // writing in immediate mode hits the operand cell
+          aInstruction.operands[i] = aAddress + 1u + i;
+        }
+        else { // nothing to do
+        }
+      }
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+  // Generated code keeps the Native in rbx, the relative base in r12 and the address
+  // to continue at in r13 when leaving. It calls only this to write memory.
+  static int64_t write(Native *aNative, uint64_t const aAddress, int64_t const aValue) noexcept {
+    int64_t result;
+    try {
+      result = (aNative->write(aAddress, aValue) ? cLeaveAfter : cContinue);
+    }
+    catch(...) {
+      result = cLeaveBefore;    // the interpreter repeats the instruction and throws
+    }
+    return result;
+  }
+
+  std::vector<uint8_t> const &assemble(size_t const aBegin, std::vector<Instruction> const &aBlock) {
+    mAssembly.clear();
+    mExits.clear();
+    emit({0x53, 0x41, 0x54, 0x41, 0x55});           // push rbx; push r12; push r13
+    emit({0x48, 0x89, 0xFB});                       // mov rbx, rdi
+    emit({0x4C, 0x8B, 0xA3});                       // mov r12, [rbx + relativeBase]
+    emit32(cRelativeBaseField);
+    size_t body = mAssembly.size();
+    size_t address = aBegin;
+    bool jumped = false;
+    for(auto const &instruction : aBlock) {
+      size_t next = address + instruction.length;
+      if(instruction.opcode == cRelativeBase) {
+        loadParameter(instruction, 0u);
+        emit({0x49, 0x01, 0xC4});                   // add r12, rax
+      }
+      else if(instruction.opcode == cJumpIfNot0 || instruction.opcode == cJumpIf0) {
+        jumped = true;
+        loadParameter(instruction, 0u);
+        if(instruction.modes[1] == cModeImmediate && static_cast<uint64_t>(instruction.operands[1]) == aBegin) {
+          emit({0x48, 0x85, 0xC0});                 // test rax, rax
+          emit({0x0F, static_cast<uint8_t>(instruction.opcode == cJumpIfNot0 ? 0x85 : 0x84)});  // jnz / jz body
+          emit32(body - (mAssembly.size() + 4u));
+          leave(next);
+        }
+        else {
+          emit({0x49, 0x89, 0xC5});                 // mov r13, rax
+          loadParameter(instruction, 1u);
+          emit({0x48, 0xB9});                       // mov rcx, next
+          emit64(next);
+          emit({0x4D, 0x85, 0xED});                 // test r13, r13
+          emit({0x48, 0x0F, static_cast<uint8_t>(instruction.opcode == cJumpIfNot0 ? 0x44 : 0x45), 0xC1});  // cmovz / cmovnz rax, rcx
+          emit({0x49, 0x89, 0xC5});                 // mov r13, rax
+          emit({0xE9});                             // jmp epilogue
+          exit();
+        }
+      }
+      else {
+        loadParameter(instruction, 0u);
+        emit({0x49, 0x89, 0xC5});                   // mov r13, rax
+        loadParameter(instruction, 1u);
+        if(instruction.opcode == cAdd) {
+          emit({0x4C, 0x01, 0xE8});                 // add rax, r13
+        }
+        else if(instruction.opcode == cMultiply) {
+          emit({0x49, 0x0F, 0xAF, 0xC5});           // imul rax, r13
+        }
+        else {
+          emit({0x49, 0x39, 0xC5});                 // cmp r13, rax
+          emit({0x0F, static_cast<uint8_t>(instruction.opcode == cLessThan ? 0x9C : 0x94), 0xC0});  // setl al / sete al
+          emit({0x0F, 0xB6, 0xC0});                 // movzx eax, al
+        }
+        store(instruction, 2u, address, next);
+      }
+      address = next;
+    }
+    if(!jumped) {
+      leave(address);
+    }
+    else { // nothing to do
+    }
+    for(auto position : mExits) {
+      patch(position, mAssembly.size());
+    }
+    // Continues in the block starting at r13 if there is one, the interpreter takes over otherwise.
+    emit({0x4C, 0x89, 0xA3});                       // mov [rbx + relativeBase], r12
+    emit32(cRelativeBaseField);
+    emit({0x4C, 0x3B, 0xAB});                       // cmp r13, [rbx + entryCount]
+    emit32(cEntryCountField);
+    emit({0x0F, 0x83});                             // jae return
+    size_t unknown = mAssembly.size();
+    emit32(0u);
+    emit({0x48, 0x8B, 0x83});                       // mov rax, [rbx + entries]
+    emit32(cEntriesField);
+    emit({0x4A, 0x8B, 0x04, 0xE8});                 // mov rax, [rax + r13 * 8]
+    emit({0x48, 0x85, 0xC0});                       // test rax, rax
+    emit({0x0F, 0x84});                             // jz return
+    size_t missing = mAssembly.size();
+    emit32(0u);
+    emit({0x48, 0x89, 0xDF});                       // mov rdi, rbx
+    emit({0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xFF, 0xE0});  // pop r13; pop r12; pop rbx; jmp rax
+    patch(unknown, mAssembly.size());
+    patch(missing, mAssembly.size());
+    emit({0x4C, 0x89, 0xE8});                       // mov rax, r13
+    emit({0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3});     // pop r13; pop r12; pop rbx; ret
+    return mAssembly;
+  }
+
+  // Leaves the parameter in rax.
+  void loadParameter(Instruction const &aInstruction, size_t const aIndex) {
+    if(aInstruction.modes[aIndex] == cModeImmediate) {
+      emit({0x48, 0xB8});                           // mov rax, value
+      emit64(aInstruction.operands[aIndex]);
+    }
+    else {
+      loadAddress(aInstruction, aIndex);
+      emit({0x48, 0x89, 0xF0});                     // mov rax, rsi
+      emit({0x48, 0xC1, 0xE8, static_cast<uint8_t>(IntcodeMemory<Int>::cPageBits)});  // shr rax, cPageBits
+      emit({0x48, 0x3B, 0x83});                     // cmp rax, [rbx + pageCount]
+      emit32(cPageCountField);
+      emit({0x0F, 0x83});                           // jae zero
+      size_t outside = mAssembly.size();
+      emit32(0u);
+      emit({0x48, 0x8B, 0x8B});                     // mov rcx, [rbx + pages]
+      emit32(cPagesField);
+      emit({0x48, 0x8B, 0x04, 0xC1});               // mov rax, [rcx + rax * 8]
+      emit({0x81, 0xE6});                           // and esi, cPageMask
+      emit32(IntcodeMemory<Int>::cPageMask);
+      emit({0x48, 0x8B, 0x04, 0xF0});               // mov rax, [rax + rsi * 8]
+      emit({0xEB, 0x02});                           // jmp done
+      patch(outside, mAssembly.size());
+      emit({0x31, 0xC0});                           // zero: xor eax, eax
+    }
+  }
+
+  // Leaves the address in rsi.
+  void loadAddress(Instruction const &aInstruction, size_t const aIndex) {
+    emit({0x48, 0xBE});                             // mov rsi, operand
+    emit64(aInstruction.operands[aIndex]);
+    if(aInstruction.modes[aIndex] == cModeRelative) {
+      emit({0x4C, 0x01, 0xE6});                     // add rsi, r12
+    }
+    else { // nothing to do
+    }
+  }
+
+  // Stores rax, leaving the block when the write hit code or failed. Cells of pages already
+  // written and inside the memory are stored directly, anything else goes through write().
+  void store(Instruction const &aInstruction, size_t const aIndex, size_t const aAddress, size_t const aNext) {
+    std::vector<size_t> slow;
+    emit({0x48, 0x89, 0xC2});                       // mov rdx, rax
+    loadAddress(aInstruction, aIndex);
+    emit({0x48, 0x3B, 0xB3});                       // cmp rsi, [rbx + codeSize]
+    emit32(cCodeSizeField);
+    emit({0x0F, 0x83});                             // jae data
+    size_t data = mAssembly.size();
+    emit32(0u);
+    emit({0x48, 0x8B, 0x83});                       // mov rax, [rbx + code]
+    emit32(cCodeField);
+    emit({0x80, 0x3C, 0x30, 0x00});                 // cmp byte [rax + rsi], 0
+    emit({0x0F, 0x85});                             // jne slow
+    slow.push_back(mAssembly.size());
+    emit32(0u);
+    patch(data, mAssembly.size());
+    emit({0x48, 0x3B, 0xB3});                       // data: cmp rsi, [rbx + size]
+    emit32(cSizeField);
+    emit({0x0F, 0x83});                             // jae slow
+    slow.push_back(mAssembly.size());
+    emit32(0u);
+    emit({0x48, 0x89, 0xF0});                       // mov rax, rsi
+    emit({0x48, 0xC1, 0xE8, static_cast<uint8_t>(IntcodeMemory<Int>::cPageBits)});  // shr rax, cPageBits
+    emit({0x48, 0x8B, 0x8B});                       // mov rcx, [rbx + writablePages]
+    emit32(cWritablePagesField);
+    emit({0x48, 0x8B, 0x04, 0xC1});                 // mov rax, [rcx + rax * 8]
+    emit({0x48, 0x85, 0xC0});                       // test rax, rax
+    emit({0x0F, 0x84});                             // jz slow
+    slow.push_back(mAssembly.size());
+    emit32(0u);
+    emit({0x81, 0xE6});                             // and esi, cPageMask
+    emit32(IntcodeMemory<Int>::cPageMask);
+    emit({0x48, 0x89, 0x14, 0xF0});                 // mov [rax + rsi * 8], rdx
+    emit({0xE9});                                   // jmp done
+    size_t done = mAssembly.size();
+    emit32(0u);
+    for(auto position : slow) {
+      patch(position, mAssembly.size());
+    }
+    call(reinterpret_cast<void const*>(&write));
+    emit({0x48, 0x85, 0xC0});                       // test rax, rax
+    emit({0x0F, 0x84});                             // jz done
+    size_t skip = mAssembly.size();
+    emit32(0u);
+    emit({0x49, 0xBD});                             // mov r13, next
+    emit64(aNext);
+    emit({0x48, 0x83, 0xF8, static_cast<uint8_t>(cLeaveAfter)});  // cmp rax, cLeaveAfter
+    emit({0x0F, 0x84});                             // je epilogue
+    exit();
+    leave(aAddress);
+    patch(skip, mAssembly.size());
+    patch(done, mAssembly.size());
+  }
+
+  void leave(size_t const aAddress) {
+    emit({0x49, 0xBD});                             // mov r13, address
+    emit64(aAddress);
+    emit({0xE9});                                   // jmp epilogue
+    exit();
+  }
+
+  void exit() {
+    mExits.push_back(mAssembly.size());
+    emit32(0u);
+  }
+
+  void call(void const *aFunction) {
+    emit({0x48, 0x89, 0xDF});                       // mov rdi, rbx
+    emit({0x48, 0xB8});                             // mov rax, function
+    emit64(reinterpret_cast<uint64_t>(aFunction));
+    emit({0xFF, 0xD0});                             // call rax
+  }
+
+  void emit(std::initializer_list<uint8_t> const aBytes) {
+    mAssembly.insert(mAssembly.end(), aBytes);
+  }
+
+  void emit32(uint32_t const aValue) {
+    for(size_t i = 0u; i < 4u; ++i) {
+      mAssembly.push_back(static_cast<uint8_t>(aValue >> (8u * i)));
+    }
+  }
+
+  void emit64(uint64_t const aValue) {
+    for(size_t i = 0u; i < 8u; ++i) {
+      mAssembly.push_back(static_cast<uint8_t>(aValue >> (8u * i)));
+    }
+  }
+
+  // Points the rel32 field at aPosition to aTarget.
+  void patch(size_t const aPosition, size_t const aTarget) {
+    uint32_t relative = static_cast<uint32_t>(aTarget - (aPosition + 4u));
+    for(size_t i = 0u; i < 4u; ++i) {
+      mAssembly[aPosition + i] = static_cast<uint8_t>(relative >> (8u * i));
+    }
+  }
+
+  // Copies the code to the current chunk, mapping a new one when it is full. x86-64 keeps
+  // instruction fetch coherent with the writes, so there is nothing to flush.
+  NativeBlock install(std::vector<uint8_t> const &aCode) {
+    NativeBlock result = nullptr;
+#ifdef INTCODE_JIT_X86_64
+    if(aCode.size() > mFreeSize) {
+      size_t pageSize = sysconf(_SC_PAGESIZE);
+      size_t size = std::max(cChunkSize, (aCode.size() + pageSize - 1u) / pageSize * pageSize);
+      void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if(memory != MAP_FAILED) {
+        mMappings.emplace_back(memory, size);
+        mFree = static_cast<uint8_t*>(memory);
+        mFreeSize = size;
+      }
+      else { // nothing to do
+      }
+    }
+    else { // nothing to do
+    }
+    if(aCode.size() <= mFreeSize) {
+      std::memcpy(mFree, aCode.data(), aCode.size());
+      result = reinterpret_cast<NativeBlock>(mFree);
+      size_t used = std::min(mFreeSize, (aCode.size() + cCodeAlignment - 1u) / cCodeAlignment * cCodeAlignment);
+      mFree += used;
+      mFreeSize -= used;
+    }
+    else { // nothing to do
+    }
+#endif
+    return result;
+  }
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef INTCODE_MEMO_H
+#define INTCODE_MEMO_H
+
+#include "intcode.h"
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <initializer_list>
+
+// Runs a program many times with input sequences sharing prefixes, like probing coordinates
+// where the same x comes with many y. The machine is forked at each point where it waits for
+// the next input and the forks are kept in a trie keyed by the inputs so far, so a run resumes
+// from the state after its longest known prefix and only the work after that is done again.
+// The state after the last input is handed to the caller and not kept. Every kept state holds
+// the memory pages it wrote, which is a few pages per distinct prefix for the usual programs.
+// Kept states adopt the code cache of a run that had to decode much, so later runs find it decoded.
+
+template<typename tNumber>
+class IntcodeMemo final {
+private:
+  static size_t constexpr cAdoptAfter = 16u;   // instructions a run has to decode for its states to adopt its code cache
+
+  struct Node final {
+    Intcode<tNumber>                         state;      // waiting for the input after the prefix leading here
+    std::map<int64_t, std::unique_ptr<Node>> children;
+  };
+
+  Node mRoot;
+
+public:
+  IntcodeMemo() = default;
+
+  IntcodeMemo(Intcode<tNumber> const &aMachine) {
+    reset(aMachine);
+  }
+
+  // Forgets all states and starts over with aMachine, which is started and run until it waits for input.
+  void reset(Intcode<tNumber> const &aMachine) {
+    mRoot.children.clear();
+    mRoot.state = aMachine;
+    mRoot.state.start();
+    mRoot.state.run();
+  }
+
+  // Returns the machine in the state start(), input() of each of aInputs and run() would have left it.
+  Intcode<tNumber> run(std::initializer_list<int64_t> const aInputs) {
+    Node *node = &mRoot;
+    auto input = aInputs.begin();
+    for(; input != aInputs.end() && input + 1 != aInputs.end(); ++input) {
+      auto &child = node->children[*input];
+      if(child == nullptr) {
+        child.reset(new Node{node->state.fork(), {}});
+        child->state.input(*input);
+        child->state.run();
+      }
+      else { // nothing to do
+      }
+      node = child.get();
+    }
+    Intcode<tNumber> result = node->state.fork();
+    for(; input != aInputs.end(); ++input) {
+      result.input(*input);
+    }
+    result.run();
+    if(result.decodeCount() - node->state.decodeCount() >= cAdoptAfter) {
+      node = &mRoot;
+      for(input = aInputs.begin(); node != nullptr; ++input) {
+        node->state.adoptCode(result);
+        node = (aInputs.end() - input > 1 ? node->children[*input].get() : nullptr);
+      }
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+};
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef INTCODE_NETWORK_H
+#define INTCODE_NETWORK_H
+
+#include "intcode.h"
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <exception>
+
+// A queue any number of threads push to and one thread pops from, without locks. Producers link
+// a node each by swapping it into the head, the consumer follows the links from the tail. While a
+// producer is between the swap and the link, the values behind its node are not visible yet.
+
+template<typename tValue>
+class IntcodeMpscQueue final {
+private:
+  struct Node final {
+    std::atomic<Node*> next{nullptr};
+    tValue             value;
+  };
+
+  std::atomic<Node*> mHead;    // the node pushed last
+  Node              *mTail;    // the consumer's node, its value is taken already
+  Node               mStub;
+
+public:
+  IntcodeMpscQueue() : mHead(&mStub), mTail(&mStub) {
+  }
+
+  IntcodeMpscQueue(IntcodeMpscQueue const &) = delete;
+  IntcodeMpscQueue &operator=(IntcodeMpscQueue const &) = delete;
+
+  ~IntcodeMpscQueue() {
+    tValue value;
+    while(pop(value)) {
+    }
+    if(mTail != &mStub) {
+      delete mTail;
+    }
+    else { // nothing to do
+    }
+  }
+
+  // Producer side, any thread.
+  void push(tValue const &aValue) {
+    Node *node = new Node;
+    node->value = aValue;
+    link(node);
+  }
+
+  // Consumer side, returns false if the queue is empty.
+  bool pop(tValue &aValue) {
+    Node *next = mTail->next.load(std::memory_order_acquire);
+    bool result = next != nullptr;
+    if(result) {
+      aValue = std::move(next->value);
+      if(mTail != &mStub) {
+        delete mTail;
+      }
+      else { // nothing to do
+      }
+      mTail = next;
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+private:
+  void link(Node *aNode) {
+    Node *previous = mHead.exchange(aNode, std::memory_order_acq_rel);
+    previous->next.store(aNode, std::memory_order_release);
+  }
+};
+
+// Runs machines exchanging packets, like the NICs of a network, spread over several threads. Each
+// machine gets its address as first input, then reads packets as two inputs x and y, or -1 when none
+// is waiting, and sends packets as three outputs: address, x and y. Packets go through a lock-free
+// queue per destination, those to other addresses to a callback.
+//
+// Machines run in budgeted slices, so attached native code is not used. A machine reading -1 twice in
+// a row without sending counts as idle, the network is idle when all machines are and no packet is on
+// its way. Both are counted in one atomic, so no thread sees the network idle while a packet moves.
+// A machine gets one -1 per slice, then waits for the next slice, so idle machines take little time,
+// and a thread whose machines are all idle yields.
+
+template<typename tNumber>
+class IntcodeNetwork final {
+public:
+  struct Packet final {
+    tNumber x;
+    tNumber y;
+  };
+
+private:
+  static size_t  constexpr cTimeSlice = 10000u;   // steps a machine runs before the next one gets its turn
+  static size_t  constexpr cIdlePolls = 2u;
+  static size_t  constexpr cPacketSize = 3u;
+  static int64_t constexpr cNoPacket = -1;
+
+  // Used by the thread running the machine only.
+  struct Node final {
+    Intcode<tNumber> machine;
+    tNumber          address;
+    bool             addressed = false;     // read its address
+    tNumber          pending;               // y of the packet whose x was read
+    bool             hasPending = false;
+    tNumber          sent[cPacketSize];
+    size_t           sentCount = 0u;
+    size_t           emptyPolls = 0u;
+    bool             polled = false;        // got -1 in this slice
+    bool             idle = false;
+    bool             halted = false;
+  };
+
+  std::vector<Node>                     mNodes;
+  std::vector<IntcodeMpscQueue<Packet>> mQueues;
+  size_t                                mThreadCount;
+  std::atomic<size_t>                   mBusy;   // machines not idle and packets not yet read
+  std::atomic<size_t>                   mHalted;
+  std::atomic<bool>                     mDone;
+  std::mutex                            mMutex;  // serializes the callbacks
+  std::exception_ptr                    mError;
+
+public:
+  // Starts aCount copies of aMachine. Uses aThreads threads, or as many
+  // as the hardware runs at once if 0.
+  IntcodeNetwork(Intcode<tNumber> const &aMachine, size_t const aCount, size_t const aThreads = 0u)
+  : mNodes(aCount)
+  , mQueues(aCount)
+  , mThreadCount(std::min(aCount, aThreads > 0u ? aThreads : std::max<size_t>(1u, std::thread::hardware_concurrency())))
+  , mBusy(aCount)
+  , mHalted(0u)
+  , mDone(false) {
+    for(size_t i = 0u; i < aCount; ++i) {
+      mNodes[i].machine = aMachine;
+      mNodes[i].machine.start();
+      mNodes[i].address = tNumber(static_cast<int64_t>(i));
+    }
+  }
+
+  IntcodeNetwork(IntcodeNetwork const &) = delete;
+  IntcodeNetwork &operator=(IntcodeNetwork const &) = delete;
+
+  size_t threadCount() const noexcept {
+    return mThreadCount;
+  }
+
+  // Sends aPacket to machine aAddress, from any thread.
+  void send(size_t const aAddress, Packet const &aPacket) {
+    mBusy.fetch_add(1u);
+    mQueues[aAddress].push(aPacket);
+  }
+
+  // Runs the machines until a callback returns true or all halted. aOther(address, packet) gets the packets sent to
+  // addresses without a machine, aIdle() is called when the network is idle and may send(). Calls to
+  // both come from any of the threads, but one at a time.
+  template<typename tOther, typename tIdle>
+  void run(tOther &&aOther, tIdle &&aIdle) {
+    mDone = false;
+    mError = nullptr;
+    std::vector<std::thread> threads;
+    for(size_t i = 1u; i < mThreadCount; ++i) {
+      threads.emplace_back([this, i, &aOther, &aIdle]() {
+        work(i, aOther, aIdle);
+      });
+    }
+    work(0u, aOther, aIdle);
+    for(auto &thread : threads) {
+      thread.join();
+    }
+    if(mError) {
+      std::rethrow_exception(mError);
+    }
+    else { // nothing to do
+    }
+  }
+
+private:
+  template<typename tOther, typename tIdle>
+  void work(size_t const aThread, tOther &aOther, tIdle &aIdle) {
+    try {
+      while(!mDone.load(std::memory_order_relaxed)) {
+        bool busy = false;
+        for(size_t i = aThread; i < mNodes.size() && !mDone.load(std::memory_order_relaxed); i += mThreadCount) {
+          step(i, aOther);
+          busy = busy || !mNodes[i].idle;
+        }
+        if(!busy) {             // leave the hardware to threads with work
+          std::this_thread::yield();
+        }
+        else { // nothing to do
+        }
+        if(mBusy.load() == 0u) {
+          std::lock_guard<std::mutex> lock(mMutex);
+          if(mBusy.load() == 0u && !mDone && aIdle()) {
+            mDone = true;
+          }
+          else { // nothing to do
+          }
+        }
+        else { // nothing to do
+        }
+      }
+    }
+    catch(...) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if(!mError) {
+        mError = std::current_exception();
+      }
+      else { // nothing to do
+      }
+      mDone = true;
+    }
+  }
+
+  // Runs machine aIndex for a slice.
+  template<typename tOther>
+  void step(size_t const aIndex, tOther &aOther) {
+    Node &node = mNodes[aIndex];
+    auto input = [this, &node, aIndex](tNumber &aValue) {
+      bool result = true;
+      Packet packet;
+      if(!node.addressed) {
+        aValue = node.address;
+        node.addressed = true;
+      }
+      else if(node.hasPending) {
+        aValue = node.pending;
+        node.hasPending = false;
+      }
+      else if(mQueues[aIndex].pop(packet)) {
+        setIdle(node, false);
+        mBusy.fetch_sub(1u);      // the packet is read, its machine is busy now
+        aValue = packet.x;
+        node.pending = packet.y;
+        node.hasPending = true;
+        node.emptyPolls = 0u;
+      }
+      else if(!node.polled) {
+        aValue = tNumber(cNoPacket);
+        node.polled = true;
+        ++node.emptyPolls;
+        setIdle(node, node.emptyPolls >= cIdlePolls);
+      }
+      else {
+        result = false;
+      }
+      return result;
+    };
+    auto output = [this, &node, &aOther](tNumber const &aValue) {
+      setIdle(node, false);
+      node.emptyPolls = 0u;
+      node.sent[node.sentCount] = aValue;
+      ++node.sentCount;
+      if(node.sentCount == cPacketSize) {
+        node.sentCount = 0u;
+        int64_t address = toInt64(node.sent[0]);
+        Packet packet{node.sent[1], node.sent[2]};
+        if(address >= 0 && static_cast<size_t>(address) < mNodes.size()) {
+          send(address, packet);
+        }
+        else {
+          std::lock_guard<std::mutex> lock(mMutex);
+          if(!mDone && aOther(address, packet)) {
+            mDone = true;
+          }
+          else { // nothing to do
+          }
+        }
+      }
+      else { // nothing to do
+      }
+      return !mDone.load(std::memory_order_relaxed);
+    };
+    if(!node.halted) {
+      node.polled = false;
+      node.halted = node.machine.run(cTimeSlice, input, output) == Intcode<tNumber>::Status::cHalted;
+      if(node.halted) {
+        setIdle(node, true);
+        if(mHalted.fetch_add(1u) + 1u == mNodes.size()) {
+          mDone = true;
+        }
+        else { // nothing to do
+        }
+      }
+      else { // nothing to do
+      }
+    }
+    else { // nothing to do
+    }
+  }
+
+  void setIdle(Node &aNode, bool const aIdle) {
+    if(aIdle && !aNode.idle) {
+      mBusy.fetch_sub(1u);
+    }
+    else if(!aIdle && aNode.idle) {
+      mBusy.fetch_add(1u);
+    }
+    else { // nothing to do
+    }
+    aNode.idle = aIdle;
+  }
+};
+
+#endif
@@ -0,0 +1,216 @@
+#ifndef INTCODE_PIPELINE_H
+#define INTCODE_PIPELINE_H
+
+#include "intcode.h"
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <exception>
+#include <condition_variable>
+
+// Runs connected machines at once, each on a thread of its own, like the amplifiers of a chain with
+// feedback, so the stages overlap instead of taking turns. A machine waiting for input spins briefly,
+// then sleeps until a value arrives. A run ends when each machine has halted or waits for input while
+// all others do too with nothing queued for them, where running the machines in turns would also end.
+// The threads stay for the next run. Machines with a JIT attached can not be used, as a JIT must not
+// be shared between threads.
+
+template<typename tNumber>
+class IntcodePipeline final {
+private:
+  static size_t constexpr cSpinCount = 64u;   // tries to get input before sleeping
+
+  struct Stage final {
+    Intcode<tNumber>                       *machine;
+    std::shared_ptr<IntcodeQueue<tNumber>>  inputs;
+    std::shared_ptr<IntcodeQueue<tNumber>>  outputs;
+    bool                                    sleeping = false;
+    bool                                    halted = false;
+  };
+
+  std::vector<Stage>       mStages;
+  std::vector<std::thread> mThreads;
+  std::mutex               mMutex;
+  std::condition_variable  mWake;       // a run starts
+  std::condition_variable  mArrived;    // input arrived or all stages starved
+  std::condition_variable  mDone;
+  std::atomic<size_t>      mSleeping;   // stages waiting on mArrived, read by producers without the lock
+  size_t                   mRun = 0u;   // count of runs so far, the stages wait for the next one
+  size_t                   mBusy = 0u;  // stages not yet done with the current run
+  size_t                   mIdle = 0u;  // stages sleeping or done
+  bool                     mStarved = false;
+  bool                     mStop = false;
+  std::exception_ptr       mError;
+
+public:
+  // Takes the machines of aMachines, connected with connect() and outliving the pipeline.
+  template<typename tMachines>
+  IntcodePipeline(tMachines &aMachines) : mSleeping(0u) {
+    for(auto &machine : aMachines) {
+      mStages.push_back(Stage{&machine, machine.inputQueue(), machine.outputQueue()});
+    }
+    for(size_t i = 0u; i < mStages.size(); ++i) {
+      mThreads.emplace_back(&IntcodePipeline::work, this, i);
+    }
+  }
+
+  IntcodePipeline(IntcodePipeline const &) = delete;
+  IntcodePipeline &operator=(IntcodePipeline const &) = delete;
+
+  ~IntcodePipeline() {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+    }
+    mWake.notify_all();
+    for(auto &thread : mThreads) {
+      thread.join();
+    }
+  }
+
+  // Runs all machines until the run ends, returning true if all halted. Machines waiting for input
+  // continue where they stopped on the next run.
+  bool run() {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mBusy = mStages.size();
+      mIdle = 0u;
+      mStarved = false;
+      mError = nullptr;
+      ++mRun;
+    }
+    mWake.notify_all();
+    bool result = true;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mDone.wait(lock, [this]{ return mBusy == 0u; });
+      for(auto const &stage : mStages) {
+        result = result && stage.halted;
+      }
+    }
+    if(mError) {
+      std::rethrow_exception(mError);
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+private:
+  void work(size_t const aIndex) {
+    Stage &stage = mStages[aIndex];
+    auto input = [this, &stage](tNumber &aValue) {
+      bool result = false;
+      for(size_t i = 0u; !result && i < cSpinCount; ++i) {
+        result = stage.inputs->pop(aValue);
+        if(!result) {
+          std::this_thread::yield();
+        }
+        else { // nothing to do
+        }
+      }
+      return result || sleep(stage, aValue);
+    };
+    auto output = [this, &stage](tNumber const &aValue) {
+      stage.outputs->push(aValue);
+      std::atomic_thread_fence(std::memory_order_seq_cst);   // pairs with the one in sleep()
+      if(mSleeping.load(std::memory_order_relaxed) > 0u) {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mArrived.notify_all();
+      }
+      else { // nothing to do
+      }
+      return true;
+    };
+    size_t run = 0u;
+    bool stop = false;
+    while(!stop) {
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mWake.wait(lock, [this, run]{ return mStop || mRun != run; });
+        stop = mStop;
+        run = mRun;
+      }
+      if(!stop) {
+        bool halted = false;
+        std::exception_ptr error;
+        try {
+          halted = stage.machine->run(input, output);
+        }
+        catch(...) {
+          error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(error && !mError) {
+          mError = error;
+        }
+        else { // nothing to do
+        }
+        stage.halted = halted;
+        if(stage.sleeping) {      // starved, so already idle
+          stage.sleeping = false;
+        }
+        else {
+          ++mIdle;
+          checkStarved();
+        }
+        if(--mBusy == 0u) {
+          mDone.notify_one();
+        }
+        else { // nothing to do
+        }
+      }
+      else { // nothing to do
+      }
+    }
+  }
+
+  // Waits for input to aStage, returning false once all stages starve.
+  bool sleep(Stage &aStage, tNumber &aValue) {
+    std::unique_lock<std::mutex> lock(mMutex);
+    aStage.sleeping = true;
+    ++mIdle;
+    mSleeping.fetch_add(1u);
+    std::atomic_thread_fence(std::memory_order_seq_cst);     // a producer missing the count sees the queue after
+    bool result = false;
+    while(!result && !mStarved) {
+      result = aStage.inputs->pop(aValue);
+      if(!result) {
+        checkStarved();
+        if(!mStarved) {
+          mArrived.wait(lock);
+        }
+        else { // nothing to do
+        }
+      }
+      else { // nothing to do
+      }
+    }
+    mSleeping.fetch_sub(1u);
+    if(result) {
+      aStage.sleeping = false;
+      --mIdle;
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+  // With the lock held: when no stage runs and none sleeping has input, nothing can arrive any more.
+  void checkStarved() {
+    bool starved = mIdle == mStages.size();
+    for(size_t i = 0u; starved && i < mStages.size(); ++i) {
+      starved = !mStages[i].sleeping || mStages[i].inputs->empty();
+    }
+    if(starved && !mStarved) {
+      mStarved = true;
+      mArrived.notify_all();
+    }
+    else { // nothing to do
+    }
+  }
+};
+
+#endif
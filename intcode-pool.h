@@ -0,0 +1,148 @@
+#ifndef INTCODE_POOL_H
+#define INTCODE_POOL_H
+
+#include "intcode.h"
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <exception>
+#include <condition_variable>
+
+// Runs a program from start for many independent input pairs on several threads, like probing
+// every point of an area. Each thread has its own copy of the machine, the copies share the
+// program image and what is known about the code. The calling thread takes part in each batch,
+// so a pool of one thread runs everything in place. Machines with a JIT attached can not be
+// pooled, as a JIT must not be shared between threads.
+
+template<typename tNumber>
+class IntcodePool final {
+public:
+  using Probe = std::pair<int64_t, int64_t>;
+
+private:
+  static size_t constexpr cChunkSize = 16u;   // probes a thread takes at a time
+
+  std::vector<Intcode<tNumber>> mMachines;    // by thread, the caller uses the first one
+  std::vector<std::thread>      mThreads;
+  std::mutex                    mMutex;
+  std::condition_variable       mWake;
+  std::condition_variable       mDone;
+  std::vector<Probe> const     *mProbes = nullptr;
+  std::vector<uint8_t>          mHits;
+  std::atomic<size_t>           mNext;
+  size_t                        mBatch = 0u;  // count of batches so far, the workers wait for the next one
+  size_t                        mBusy = 0u;   // workers not yet done with the current batch
+  bool                          mStop = false;
+  std::exception_ptr            mError;
+
+public:
+  // Uses aThreads threads including the caller, or as many as the hardware runs at once if 0.
+  IntcodePool(Intcode<tNumber> const &aMachine, size_t const aThreads = 0u) : mNext(0u) {
+    size_t threads = (aThreads > 0u ? aThreads : std::max(1u, std::thread::hardware_concurrency()));
+    mMachines.assign(threads, aMachine);
+    for(size_t i = 1u; i < threads; ++i) {
+      mThreads.emplace_back(&IntcodePool::work, this, i);
+    }
+  }
+
+  IntcodePool(IntcodePool const &) = delete;
+  IntcodePool &operator=(IntcodePool const &) = delete;
+
+  ~IntcodePool() {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+    }
+    mWake.notify_all();
+    for(auto &thread : mThreads) {
+      thread.join();
+    }
+  }
+
+  size_t threadCount() const noexcept {
+    return mMachines.size();
+  }
+
+  // Starts the program for each probe, feeds it the two numbers and runs it until it halts or waits
+  // for more input. Bit i of the result tells if probe i gave a nonzero first output.
+  std::vector<bool> probeBatch(std::vector<Probe> const &aProbes) {
+    mProbes = &aProbes;
+    mHits.assign(aProbes.size(), 0u);
+    mNext = 0u;
+    mError = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mBusy = mThreads.size();
+      ++mBatch;
+    }
+    mWake.notify_all();
+    probe(mMachines.front());
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mDone.wait(lock, [this]{ return mBusy == 0u; });
+    }
+    mProbes = nullptr;
+    if(mError) {
+      std::rethrow_exception(mError);
+    }
+    else { // nothing to do
+    }
+    return std::vector<bool>(mHits.begin(), mHits.end());
+  }
+
+private:
+  void work(size_t const aIndex) {
+    size_t batch = 0u;
+    bool stop = false;
+    while(!stop) {
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mWake.wait(lock, [this, batch]{ return mStop || mBatch != batch; });
+        stop = mStop;
+        batch = mBatch;
+      }
+      if(!stop) {
+        probe(mMachines[aIndex]);
+        std::lock_guard<std::mutex> lock(mMutex);
+        if(--mBusy == 0u) {
+          mDone.notify_one();
+        }
+        else { // nothing to do
+        }
+      }
+      else { // nothing to do
+      }
+    }
+  }
+
+  void probe(Intcode<tNumber> &aMachine) {
+    size_t count = mProbes->size();
+    try {
+      for(size_t begin = mNext.fetch_add(cChunkSize); begin < count; begin = mNext.fetch_add(cChunkSize)) {
+        size_t end = std::min(count, begin + cChunkSize);
+        for(size_t i = begin; i < end; ++i) {
+          aMachine.start();
+          aMachine.input((*mProbes)[i].first);
+          aMachine.input((*mProbes)[i].second);
+          aMachine.run();
+          mHits[i] = (aMachine.hasOutput() && aMachine.output() != 0 ? 1u : 0u);
+        }
+      }
+    }
+    catch(...) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if(!mError) {
+        mError = std::current_exception();
+      }
+      else { // nothing to do
+      }
+      mNext = count;
+    }
+  }
+};
+
+#endif
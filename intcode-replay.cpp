@@ -0,0 +1,44 @@
+#include "intcode-image.h"
+#include "intcode-trace.h"
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+// Restores the machines of a trace written by IntcodeRecorder at a checkpoint, the last one
+// by default, without running anything before it. Then replays them up to the next checkpoint
+// or the end of the trace, checking their outputs and states against the trace.
+// Usage: intcode-replay program trace [checkpoint]
+
+int main(int const argc, char **argv) {
+  try {
+    if(argc < 3) {
+      throw std::invalid_argument("Need program and trace filename.");
+    }
+    Intcode<Int> program = loadIntcode<Int>(argv[1]);
+    IntcodeReplay<Int> trace(argv[2]);
+    if(trace.checkpointCount() == 0u) {
+      throw std::invalid_argument("No checkpoint in trace.");
+    }
+    else { // nothing to do
+    }
+    size_t checkpoint = (argc > 3 ? std::stoul(argv[3]) : trace.checkpointCount() - 1u);
+    auto begin = std::chrono::high_resolution_clock::now();
+    std::vector<Intcode<Int>> machines = trace.restore(checkpoint, program);
+    auto restored = std::chrono::high_resolution_clock::now();
+    trace.replay(checkpoint, machines);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "checkpoint " << checkpoint << " of " << trace.checkpointCount() << ", " << machines.size() << " machines\n";
+    std::cout << "restore: " << std::chrono::duration<double>(restored - begin).count() << " replay: " << std::chrono::duration<double>(end - restored).count() << '\n';
+    for(size_t i = 0u; i < machines.size(); ++i) {
+      std::cout << i << ": at " << machines[i].programCounter() << " base " << machines[i].relativeBase() << ' ';
+      machines[i].printStatus();
+    }
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
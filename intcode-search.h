@@ -0,0 +1,113 @@
+#ifndef INTCODE_SEARCH_H
+#define INTCODE_SEARCH_H
+
+#include <mutex>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <numeric>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+
+// Searches the phase orders of an amplifier chain for the largest signal on all hardware threads. Phase
+// orders are numbered in lexicographic order, so the threads take chunks of them by number and each
+// evaluates its chunks with a worker of its own, which the caller supplies.
+
+class IntcodePhaseSearch final {
+private:
+  static size_t constexpr cChunkSize = 720u;   // orders a thread takes at a time
+  static size_t constexpr cMaxLength = 20u;    // the count of orders must fit size_t
+
+  size_t              mLength;
+  int                 mFirstPhase;
+  size_t              mCount;
+  std::atomic<size_t> mNext;
+  std::mutex          mMutex;
+  int64_t             mLargest = std::numeric_limits<int64_t>::min();
+  std::exception_ptr  mError;
+
+public:
+  IntcodePhaseSearch(size_t const aLength, int const aFirstPhase) : mLength(aLength), mFirstPhase(aFirstPhase), mCount(1u), mNext(0u) {
+    if(aLength == 0u || aLength > cMaxLength) {
+      throw std::invalid_argument("Invalid chain length.");
+    }
+    else { // nothing to do
+    }
+    for(size_t i = 2u; i <= aLength; ++i) {
+      mCount *= i;
+    }
+  }
+
+  // The most orders a worker gets at a time.
+  size_t chunkSize() const noexcept {
+    return std::min(cChunkSize, mCount);
+  }
+
+  // Calls aMakeWorker() once on each thread for a worker, and aWorker(phases, count) for each chunk it
+  // takes, which runs count orders from phases on and returns the largest signal. Returns the largest of all.
+  // Workers running aThreadsPerWorker threads of their own leave as many hardware threads to them.
+  template<typename tMakeWorker>
+  int64_t run(tMakeWorker const &aMakeWorker, size_t const aThreadsPerWorker = 1u) {
+    size_t threadCount = std::max<size_t>(1u, std::thread::hardware_concurrency() / aThreadsPerWorker);
+    std::vector<std::thread> threads;
+    for(size_t i = 1u; i < threadCount; ++i) {
+      threads.emplace_back([this, &aMakeWorker]() {
+        work(aMakeWorker);
+      });
+    }
+    work(aMakeWorker);
+    for(auto &thread : threads) {
+      thread.join();
+    }
+    if(mError) {
+      std::rethrow_exception(mError);
+    }
+    else { // nothing to do
+    }
+    return mLargest;
+  }
+
+private:
+  template<typename tMakeWorker>
+  void work(tMakeWorker const &aMakeWorker) {
+    int64_t largest = std::numeric_limits<int64_t>::min();
+    try {
+      auto worker = aMakeWorker();
+      for(size_t begin = mNext.fetch_add(cChunkSize); begin < mCount; begin = mNext.fetch_add(cChunkSize)) {
+        largest = std::max(largest, worker(permutation(begin), std::min(cChunkSize, mCount - begin)));
+      }
+    }
+    catch(...) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if(!mError) {
+        mError = std::current_exception();
+      }
+      else { // nothing to do
+      }
+      mNext = mCount;
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLargest = std::max(mLargest, largest);
+  }
+
+  // The phase order numbered aIndex.
+  std::vector<int> permutation(size_t aIndex) const {
+    std::vector<int> available(mLength);
+    std::iota(available.begin(), available.end(), mFirstPhase);
+    size_t factorial = mCount;
+    std::vector<int> result;
+    for(size_t i = mLength; i > 0u; --i) {
+      factorial /= i;
+      size_t which = aIndex / factorial;
+      aIndex %= factorial;
+      result.push_back(available[which]);
+      available.erase(available.begin() + which);
+    }
+    return result;
+  }
+};
+
+#endif
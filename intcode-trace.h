@@ -0,0 +1,475 @@
+#ifndef INTCODE_TRACE_H
+#define INTCODE_TRACE_H
+
+#include "intcode.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <ostream>
+#include <algorithm>
+#include <stdexcept>
+
+// Records what a set of machines read and write while they run, so a misbehaving session can be
+// examined later without running it again from the start. Programs are deterministic, so the inputs
+// each machine consumed are enough to reproduce it, the outputs are kept to check the replay.
+// Periodic checkpoints hold the state of all machines, IntcodeReplay restores any of them directly
+// and replays from there.
+//
+// The trace is 8 magic bytes followed by records, each a tag byte and LEB128 numbers, the signed
+// ones zigzag encoded. A machine record selects the machine the following input and output records
+// belong to, and is only written when that changes. Each run ends with a stop record, holding 0 when
+// the machine halted, 1 when it waits for input and 2 plus the steps budget when it was preempted,
+// so a replay repeats the runs and stops each machine exactly where it stopped. A checkpoint record holds the state of each
+// machine: its program counter and relative base, its memory size, the cells differing from the
+// program as distance from the previous one and value, and the contents of its queues.
+// Cells must fit into int64_t.
+
+class IntcodeTraceFormat {
+protected:
+  static uint64_t constexpr cMagic      = 0x3143525443544e49u;   // "INTCTRC1", written byte by byte from the lowest
+  static size_t   constexpr cMagicSize  = sizeof(cMagic);
+  static uint8_t  constexpr cMachine    = 0u;
+  static uint8_t  constexpr cInput      = 1u;
+  static uint8_t  constexpr cOutput     = 2u;
+  static uint8_t  constexpr cCheckpoint = 3u;
+  static uint8_t  constexpr cStop       = 4u;
+  static uint64_t constexpr cStopHalted    = 0u;
+  static uint64_t constexpr cStopSuspended = 1u;
+  static uint64_t constexpr cStopPreempted = 2u;   // plus the budget
+
+  static uint64_t zigzag(int64_t const aValue) noexcept {
+    return (static_cast<uint64_t>(aValue) << 1u) ^ static_cast<uint64_t>(aValue >> 63);
+  }
+
+  static int64_t unzigzag(uint64_t const aValue) noexcept {
+    return static_cast<int64_t>(aValue >> 1u) ^ -static_cast<int64_t>(aValue & 1u);
+  }
+};
+
+template<typename tNumber>
+class IntcodeRecorder final : private IntcodeTraceFormat {
+public:
+  using Status = typename Intcode<tNumber>::Status;
+
+  static size_t constexpr cDefaultInterval = 1u << 16u;   // inputs and outputs between checkpoints
+
+private:
+  static size_t constexpr cFlushSize = 1u << 16u;
+  static size_t constexpr cNoMachine = ~size_t(0u);
+
+  std::ostream                   &mOut;
+  std::vector<Intcode<tNumber>*>  mMachines;
+  std::string                     mBuffer;
+  size_t                          mInterval;
+  size_t                          mEvents      = 0u;   // since the last checkpoint
+  size_t                          mCheckpoints = 0u;
+  size_t                          mCurrent     = cNoMachine;
+
+public:
+  // Writes to aOut, which must be opened in binary mode, a checkpoint every aInterval inputs and outputs.
+  IntcodeRecorder(std::ostream &aOut, size_t const aInterval = cDefaultInterval) : mOut(aOut), mInterval(aInterval) {
+    for(size_t i = 0u; i < cMagicSize; ++i) {
+      mBuffer.push_back(static_cast<char>(cMagic >> (i * 8u)));
+    }
+  }
+
+  IntcodeRecorder(IntcodeRecorder const &) = delete;
+  IntcodeRecorder &operator=(IntcodeRecorder const &) = delete;
+
+  ~IntcodeRecorder() {
+    flush();
+  }
+
+  // Records aMachine from now on, it must outlive the recorder. Returns its index in the trace.
+  size_t add(Intcode<tNumber> &aMachine) {
+    mMachines.push_back(&aMachine);
+    return mMachines.size() - 1u;
+  }
+
+  // Runs machine aIndex like its run() does, recording the inputs it takes from its queue and the
+  // outputs it puts into its queue. Writes a checkpoint before the first run and when due.
+  bool run(size_t const aIndex) {
+    return record<false>(aIndex, 0u) == Status::cHalted;
+  }
+
+  // Runs machine aIndex like its run(aMaxSteps) does, recording like run(aIndex).
+  Status run(size_t const aIndex, size_t const aMaxSteps) {
+    return record<true>(aIndex, aMaxSteps);
+  }
+
+  // Saves the state of all machines, which must not be running.
+  void checkpoint() {
+    mBuffer.push_back(cCheckpoint);
+    writeNumber(mMachines.size());
+    for(auto machine : mMachines) {
+      save(*machine);
+    }
+    mEvents = 0u;
+    ++mCheckpoints;
+    flush();
+  }
+
+  void flush() {
+    mOut.write(mBuffer.data(), mBuffer.size());
+    mOut.flush();
+    mBuffer.clear();
+  }
+
+private:
+  template<bool tBudgeted>
+  Status record(size_t const aIndex, size_t const aMaxSteps) {
+    if(mCheckpoints == 0u || mEvents >= mInterval) {
+      checkpoint();
+    }
+    else { // nothing to do
+    }
+    if(aIndex != mCurrent) {
+      mBuffer.push_back(cMachine);
+      writeNumber(aIndex);
+      mCurrent = aIndex;
+    }
+    else { // nothing to do
+    }
+    Intcode<tNumber> &machine = *mMachines[aIndex];
+    IntcodeQueue<tNumber> &inputs = *machine.inputQueue();
+    IntcodeQueue<tNumber> &outputs = *machine.outputQueue();
+    auto input = [this, &inputs](tNumber &aValue) {
+      bool result = inputs.pop(aValue);
+      if(result) {
+        writeEvent(cInput, aValue);
+      }
+      else { // nothing to do
+      }
+      return result;
+    };
+    auto output = [this, &outputs](tNumber const &aValue) {
+      outputs.push(aValue);
+      writeEvent(cOutput, aValue);
+      return true;
+    };
+    Status result;
+    if constexpr(tBudgeted) {
+      result = machine.run(aMaxSteps, input, output);
+    }
+    else {
+      result = (machine.run(input, output) ? Status::cHalted : Status::cSuspended);
+    }
+    mBuffer.push_back(cStop);
+    writeNumber(result == Status::cPreempted ? cStopPreempted + aMaxSteps : (result == Status::cSuspended ? cStopSuspended : cStopHalted));
+    if(mBuffer.size() >= cFlushSize) {
+      flush();
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+  void save(Intcode<tNumber> &aMachine) {
+    auto const &program = aMachine.program();
+    size_t size = aMachine.memorySize();
+    writeNumber(aMachine.programCounter());
+    writeNumber(aMachine.relativeBase());
+    writeNumber(size);
+    std::vector<size_t> changed;
+    for(size_t i = 0u; i < size; ++i) {
+      if(aMachine.peek(i) != (i < program.size() ? program[i] : tNumber(0))) {
+        changed.push_back(i);
+      }
+      else { // nothing to do
+      }
+    }
+    writeNumber(changed.size());
+    size_t previous = 0u;
+    for(auto i : changed) {
+      writeNumber(i - previous);
+      writeValue(aMachine.peek(i));
+      previous = i;
+    }
+    saveQueue(*aMachine.inputQueue());
+    saveQueue(*aMachine.outputQueue());
+  }
+
+  void saveQueue(IntcodeQueue<tNumber> const &aQueue) {
+    IntcodeQueue<tNumber> copy(aQueue);
+    writeNumber(copy.size());
+    tNumber value;
+    while(copy.pop(value)) {
+      writeValue(value);
+    }
+  }
+
+  void writeEvent(uint8_t const aTag, tNumber const &aValue) {
+    mBuffer.push_back(aTag);
+    writeValue(aValue);
+    ++mEvents;
+  }
+
+  void writeValue(tNumber const &aValue) {
+    if(!fitsInt64(aValue)) {
+      throw std::invalid_argument("Number does not fit into a trace.");
+    }
+    else { // nothing to do
+    }
+    writeNumber(zigzag(toInt64(aValue)));
+  }
+
+  void writeNumber(uint64_t aValue) {
+    while(aValue >= 0x80u) {
+      mBuffer.push_back(static_cast<char>(aValue | 0x80u));
+      aValue >>= 7u;
+    }
+    mBuffer.push_back(static_cast<char>(aValue));
+  }
+};
+
+template<typename tNumber>
+class IntcodeReplay final : private IntcodeTraceFormat {
+private:
+  struct Event final {
+    uint8_t  tag;
+    uint64_t value;    // zigzag encoded for inputs and outputs
+  };
+
+  std::vector<uint8_t> mTrace;
+  std::vector<size_t>  mCheckpoints;   // offsets of the checkpoint records
+  mutable size_t       mPosition = 0u;
+
+public:
+  IntcodeReplay(std::string const &aFilename) {
+    std::ifstream in(aFilename, std::ios::binary);
+    mTrace.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    uint64_t magic = 0u;
+    for(size_t i = 0u; i < cMagicSize && i < mTrace.size(); ++i) {
+      magic |= static_cast<uint64_t>(mTrace[i]) << (i * 8u);
+    }
+    if(mTrace.size() < cMagicSize || magic != cMagic) {
+      throw std::invalid_argument("Invalid trace.");
+    }
+    else { // nothing to do
+    }
+    mPosition = cMagicSize;
+    while(mPosition < mTrace.size()) {
+      uint8_t tag = mTrace[mPosition];
+      if(tag == cCheckpoint) {
+        mCheckpoints.push_back(mPosition);
+        ++mPosition;
+        for(size_t count = readNumber(); count > 0u; --count) {
+          skipState();
+        }
+      }
+      else if(tag == cMachine || tag == cInput || tag == cOutput || tag == cStop) {
+        ++mPosition;
+        readNumber();
+      }
+      else {
+        throw std::invalid_argument("Invalid trace.");
+      }
+    }
+  }
+
+  size_t checkpointCount() const noexcept {
+    return mCheckpoints.size();
+  }
+
+  // Returns the machines in their state at checkpoint aCheckpoint, each a copy of aMachine loaded
+  // with the program recorded. Nothing runs.
+  std::vector<Intcode<tNumber>> restore(size_t const aCheckpoint, Intcode<tNumber> const &aMachine) const {
+    mPosition = checkpoint(aCheckpoint) + 1u;
+    std::vector<Intcode<tNumber>> result(readNumber(), aMachine);
+    for(auto &machine : result) {
+      restoreState(machine);
+    }
+    return result;
+  }
+
+  // Runs aMachines, in their state at checkpoint aCheckpoint, on the inputs recorded up to the next
+  // checkpoint or the end of the trace. The inputs come from the trace, the input queues only lose
+  // what they held at the checkpoint as it is consumed, outputs go to the queues as when recorded.
+  // Throws if an output or the state at the next checkpoint differs from the trace.
+  void replay(size_t const aCheckpoint, std::vector<Intcode<tNumber>> &aMachines) const {
+    mPosition = checkpoint(aCheckpoint) + 1u;
+    size_t count = readNumber();
+    if(count != aMachines.size()) {
+      throw std::invalid_argument("Machine count differs from the trace.");
+    }
+    else { // nothing to do
+    }
+    for(size_t i = 0u; i < count; ++i) {
+      skipState();
+    }
+    std::vector<std::vector<Event>> events(count);
+    size_t current = 0u;
+    while(mPosition < mTrace.size() && mTrace[mPosition] != cCheckpoint) {
+      uint8_t tag = mTrace[mPosition];
+      ++mPosition;
+      uint64_t number = readNumber();
+      if(tag == cMachine) {
+        current = number;
+      }
+      else if(current < count) {
+        events[current].push_back(Event{tag, number});
+      }
+      else {
+        throw std::invalid_argument("Invalid trace.");
+      }
+    }
+    for(size_t i = 0u; i < count; ++i) {
+      replay(events[i], aMachines[i]);
+    }
+    if(aCheckpoint + 1u < mCheckpoints.size()) {
+      std::vector<Intcode<tNumber>> expected = restore(aCheckpoint + 1u, aMachines.front());
+      for(size_t i = 0u; i < count; ++i) {
+        compare(aMachines[i], expected[i]);
+      }
+    }
+    else { // nothing to do
+    }
+  }
+
+private:
+  size_t checkpoint(size_t const aCheckpoint) const {
+    if(aCheckpoint >= mCheckpoints.size()) {
+      throw std::invalid_argument("No such checkpoint.");
+    }
+    else { // nothing to do
+    }
+    return mCheckpoints[aCheckpoint];
+  }
+
+  // Repeats the runs recorded, each up to its stop record and with the budget recorded for preempted ones.
+  static void replay(std::vector<Event> const &aEvents, Intcode<tNumber> &aMachine) {
+    using Status = typename Intcode<tNumber>::Status;
+    auto const &inputs = aMachine.inputQueue();
+    auto const &outputs = aMachine.outputQueue();
+    auto event = aEvents.begin();
+    auto input = [&event, &aEvents, &inputs](tNumber &aValue) {
+      bool result = event != aEvents.end() && event->tag == cInput;
+      if(result) {
+        inputs->pop(aValue);    // what was queued at the checkpoint, the same values as the trace has
+        aValue = tNumber(unzigzag(event->value));
+        ++event;
+      }
+      else { // nothing to do
+      }
+      return result;
+    };
+    auto output = [&event, &aEvents, &outputs](tNumber const &aValue) {
+      if(event == aEvents.end() || event->tag != cOutput || aValue != tNumber(unzigzag(event->value))) {
+        throw std::invalid_argument("Replay diverged.");
+      }
+      else { // nothing to do
+      }
+      ++event;
+      outputs->push(aValue);
+      return true;
+    };
+    while(event != aEvents.end()) {
+      auto stop = std::find_if(event, aEvents.end(), [](Event const &aEvent) {
+        return aEvent.tag == cStop;
+      });
+      if(stop == aEvents.end()) {
+        throw std::invalid_argument("Invalid trace.");
+      }
+      else { // nothing to do
+      }
+      Status status;
+      Status expected;
+      if(stop->value >= cStopPreempted) {
+        status = aMachine.run(stop->value - cStopPreempted, input, output);
+        expected = Status::cPreempted;
+      }
+      else {
+        status = (aMachine.run(input, output) ? Status::cHalted : Status::cSuspended);
+        expected = (stop->value == cStopSuspended ? Status::cSuspended : Status::cHalted);
+      }
+      if(event != stop || status != expected) {
+        throw std::invalid_argument("Replay diverged.");
+      }
+      else { // nothing to do
+      }
+      ++event;
+    }
+  }
+
+  // Inputs replayed come from the trace, so only the registers and memory are compared.
+  static void compare(Intcode<tNumber> const &aActual, Intcode<tNumber> const &aExpected) {
+    bool same = aActual.programCounter() == aExpected.programCounter() && aActual.relativeBase() == aExpected.relativeBase()
+             && aActual.memorySize() == aExpected.memorySize();
+    for(size_t i = 0u; same && i < aActual.memorySize(); ++i) {
+      same = aActual.peek(i) == aExpected.peek(i);
+    }
+    if(!same) {
+      throw std::invalid_argument("Replay diverged.");
+    }
+    else { // nothing to do
+    }
+  }
+
+  void restoreState(Intcode<tNumber> &aMachine) const {
+    aMachine.start();
+    size_t programCounter = readNumber();
+    size_t relativeBase = readNumber();
+    size_t size = readNumber();
+    size_t address = 0u;
+    for(size_t count = readNumber(); count > 0u; --count) {
+      address += readNumber();
+      aMachine.poke(address, readValue());
+    }
+    if(size > aMachine.memorySize()) {
+      aMachine.poke(size - 1u, aMachine.peek(size - 1u));
+    }
+    else { // nothing to do
+    }
+    aMachine.resume(programCounter, relativeBase);
+    for(size_t count = readNumber(); count > 0u; --count) {
+      aMachine.input(readValue());
+    }
+    auto const &outputs = aMachine.outputQueue();
+    for(size_t count = readNumber(); count > 0u; --count) {
+      outputs->push(readValue());
+    }
+  }
+
+  void skipState() const {
+    readNumber();
+    readNumber();
+    readNumber();
+    for(size_t count = readNumber(); count > 0u; --count) {
+      readNumber();
+      readNumber();
+    }
+    for(size_t queue = 0u; queue < 2u; ++queue) {
+      for(size_t count = readNumber(); count > 0u; --count) {
+        readNumber();
+      }
+    }
+  }
+
+  tNumber readValue() const {
+    return tNumber(unzigzag(readNumber()));
+  }
+
+  uint64_t readNumber() const {
+    uint64_t result = 0u;
+    for(size_t shift = 0u; ; shift += 7u) {
+      if(mPosition >= mTrace.size() || shift >= 64u) {
+        throw std::invalid_argument("Invalid trace.");
+      }
+      else { // nothing to do
+      }
+      uint8_t byte = mTrace[mPosition];
+      ++mPosition;
+      result |= static_cast<uint64_t>(byte & 0x7fu) << shift;
+      if((byte & 0x80u) == 0u) {
+        break;
+      }
+      else { // nothing to do
+      }
+    }
+    return result;
+  }
+};
+
+#endif
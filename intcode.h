@@ -0,0 +1,1779 @@
+#ifndef INTCODE_H
+#define INTCODE_H
+
+#include "infint.h"
+#include "intcode-isa.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <climits>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <utility>
+
+// Shared Intcode engine used by all the days needing it.
+// tNumber is the cell type: Int for the 64-bit days, SafeInt where bignums may be needed, InfInt still works.
+
+class Int final {
+private:
+  int64_t mInt;
+
+public:
+  Int() noexcept = default;
+
+  Int(int64_t aInt) noexcept : mInt(aInt) {
+  }
+
+  Int(std::string const &aString) : mInt(std::stoll(aString)) {
+  }
+
+  int64_t toInt() const noexcept {
+    return mInt;
+  }
+
+  operator int64_t() const noexcept {
+    return mInt;
+  }
+
+  Int &operator=(int64_t const aInt) noexcept {
+    mInt = aInt;
+    return *this;
+  }
+};
+
+inline bool fitsInt64(Int const &) noexcept {
+  return true;
+}
+
+inline int64_t toInt64(Int const &aNumber) noexcept {
+  return aNumber.toInt();
+}
+
+inline bool fitsInt64(InfInt const &aNumber) {
+  return aNumber >= LLONG_MIN && aNumber <= LLONG_MAX;
+}
+
+inline int64_t toInt64(InfInt const &aNumber) {
+  return aNumber.toLongLong();
+}
+
+// Computes with int64_t and keeps an InfInt only for values not fitting into that,
+// so programs get about the speed of Int and the range of InfInt.
+class SafeInt final {
+private:
+  int64_t mSmall = 0;
+  InfInt *mBig   = nullptr;   // owned, set exactly when the value does not fit into mSmall
+
+public:
+  SafeInt() noexcept = default;
+
+  SafeInt(int64_t const aSmall) noexcept : mSmall(aSmall) {
+  }
+
+  SafeInt(InfInt const &aBig) {
+    assign(aBig);
+  }
+
+  SafeInt(std::string const &aString) {
+    assign(InfInt(aString));
+  }
+
+  SafeInt(SafeInt const &aOther) : mSmall(aOther.mSmall), mBig(aOther.mBig == nullptr ? nullptr : new InfInt(*aOther.mBig)) {
+  }
+
+  SafeInt(SafeInt &&aOther) noexcept : mSmall(aOther.mSmall), mBig(aOther.mBig) {
+    aOther.mBig = nullptr;
+  }
+
+  ~SafeInt() {
+    delete mBig;
+  }
+
+  SafeInt &operator=(SafeInt const &aOther) {
+    if(aOther.mBig == nullptr) {
+      delete mBig;
+      mBig = nullptr;
+      mSmall = aOther.mSmall;
+    }
+    else if(this != &aOther) {
+      assign(*aOther.mBig);
+    }
+    else { // nothing to do
+    }
+    return *this;
+  }
+
+  SafeInt &operator=(SafeInt &&aOther) noexcept {
+    mSmall = aOther.mSmall;
+    std::swap(mBig, aOther.mBig);
+    return *this;
+  }
+
+  bool isBig() const noexcept {
+    return mBig != nullptr;
+  }
+
+  int64_t toInt() const {
+    return mBig == nullptr ? mSmall : mBig->toLongLong();
+  }
+
+  InfInt toInfInt() const {
+    return mBig == nullptr ? InfInt(static_cast<long long>(mSmall)) : *mBig;
+  }
+
+  friend SafeInt operator+(SafeInt const &aLeft, SafeInt const &aRight) {
+    int64_t result;
+    return aLeft.mBig == nullptr && aRight.mBig == nullptr && add(aLeft.mSmall, aRight.mSmall, result) ? SafeInt(result) : SafeInt(aLeft.toInfInt() + aRight.toInfInt());
+  }
+
+  friend SafeInt operator*(SafeInt const &aLeft, SafeInt const &aRight) {
+    int64_t result;
+    return aLeft.mBig == nullptr && aRight.mBig == nullptr && multiply(aLeft.mSmall, aRight.mSmall, result) ? SafeInt(result) : SafeInt(aLeft.toInfInt() * aRight.toInfInt());
+  }
+
+  friend bool operator==(SafeInt const &aLeft, SafeInt const &aRight) {
+    return aLeft.mBig == nullptr && aRight.mBig == nullptr ? aLeft.mSmall == aRight.mSmall : aLeft.toInfInt() == aRight.toInfInt();
+  }
+
+  friend bool operator!=(SafeInt const &aLeft, SafeInt const &aRight) {
+    return !(aLeft == aRight);
+  }
+
+  friend bool operator<(SafeInt const &aLeft, SafeInt const &aRight) {
+    return aLeft.mBig == nullptr && aRight.mBig == nullptr ? aLeft.mSmall < aRight.mSmall : aLeft.toInfInt() < aRight.toInfInt();
+  }
+
+  friend std::ostream &operator<<(std::ostream &aOut, SafeInt const &aNumber) {
+    if(aNumber.mBig == nullptr) {
+      aOut << aNumber.mSmall;
+    }
+    else {
+      aOut << *aNumber.mBig;
+    }
+    return aOut;
+  }
+
+private:
+  void assign(InfInt const &aBig) {
+    if(fitsInt64(aBig)) {
+      delete mBig;
+      mBig = nullptr;
+      mSmall = toInt64(aBig);
+    }
+    else if(mBig != nullptr) {
+      *mBig = aBig;
+    }
+    else {
+      mBig = new InfInt(aBig);
+    }
+  }
+
+  // These return false instead of a result that overflowed.
+  static bool add(int64_t const aLeft, int64_t const aRight, int64_t &aResult) noexcept {
+#if defined(__GNUC__)
+    return !__builtin_add_overflow(aLeft, aRight, &aResult);
+#else
+    bool fits = (aRight >= 0 ? aLeft <= INT64_MAX - aRight : aLeft >= INT64_MIN - aRight);
+    aResult = (fits ? aLeft + aRight : 0);
+    return fits;
+#endif
+  }
+
+  static bool multiply(int64_t const aLeft, int64_t const aRight, int64_t &aResult) noexcept {
+#if defined(__GNUC__)
+    return !__builtin_mul_overflow(aLeft, aRight, &aResult);
+#else
+    aResult = static_cast<int64_t>(static_cast<uint64_t>(aLeft) * static_cast<uint64_t>(aRight));
+    return aLeft == 0 || (aLeft == -1 ? aRight != INT64_MIN : aResult / aLeft == aRight && !(aRight == -1 && aLeft == INT64_MIN));
+#endif
+  }
+};
+
+inline bool fitsInt64(SafeInt const &aNumber) noexcept {
+  return !aNumber.isBig();
+}
+
+inline int64_t toInt64(SafeInt const &aNumber) {
+  return aNumber.toInt();
+}
+
+#ifdef INTCODE_PROFILE
+// Execution counts of a machine, collected only when INTCODE_PROFILE is defined, so builds
+// without it carry neither the members nor the counting. Instructions run by attached native
+// code are not seen one by one, only the entries into native blocks are counted.
+class IntcodeProfile final {
+public:
+  static size_t constexpr cOpcodeCount = 14u;   // the decoded opcodes, halt and the fused ones last
+  static size_t constexpr cFirstFused  = 11u;
+  static size_t constexpr cModeCount   =  3u;
+
+  uint64_t              opcodes[cOpcodeCount] = {};
+  uint64_t              modes[cModeCount] = {};   // by addressing mode of each operand executed
+  std::vector<uint64_t> programCounters;          // instructions executed at each address, fused ones at that of the first
+  uint64_t              nativeBlocks = 0u;        // entries into native blocks
+  uint64_t              decodes = 0u;
+  uint64_t              pageAllocations = 0u;     // memory pages written first or copied from a fork
+  uint64_t              tableGrowths = 0u;        // times the page table grew
+  size_t                peakSize = 0u;            // largest memory size in cells after a run
+
+  void step(size_t const aProgramCounter, size_t const aOpcode, uint8_t const *aModes, size_t const aOperandCount) {
+    ++opcodes[aOpcode];
+    for(size_t i = 0u; i < aOperandCount; ++i) {
+      ++modes[aModes[i]];
+    }
+    if(aProgramCounter >= programCounters.size()) {
+      programCounters.resize(std::max(aProgramCounter + 1u, programCounters.size() * 2u), 0u);
+    }
+    else { // nothing to do
+    }
+    ++programCounters[aProgramCounter];
+  }
+
+  // Counts a fused instruction as the two it is.
+  uint64_t instructionCount() const noexcept {
+    uint64_t result = 0u;
+    for(size_t i = 0u; i < cOpcodeCount; ++i) {
+      result += (i < cFirstFused ? opcodes[i] : 2u * opcodes[i]);
+    }
+    return result;
+  }
+
+  // Prints the counts by opcode and mode, the memory statistics and the aHotCount addresses run most.
+  void print(std::ostream &aOut, size_t const aHotCount = 20u) const {
+    static char const * const cOpcodeNames[cOpcodeCount] = { "invalid", "add", "multiply", "input", "output", "jumpIfNot0", "jumpIf0", "lessThan", "equals", "relativeBase", "halt", "lessThan+jump", "equals+jump", "relativeBase+jump" };
+    static char const * const cModeNames[cModeCount] = { "position", "immediate", "relative" };
+    uint64_t total = instructionCount();
+    uint64_t operands = 0u;
+    for(auto count : modes) {
+      operands += count;
+    }
+    aOut << "instructions: " << total << " decodes: " << decodes << " native blocks: " << nativeBlocks << '\n';
+    for(size_t i = 1u; i < cOpcodeCount; ++i) {
+      aOut << "  " << cOpcodeNames[i] << ": " << opcodes[i] << " (" << percent(opcodes[i], total) << "%)\n";
+    }
+    aOut << "operands: " << operands << '\n';
+    for(size_t i = 0u; i < cModeCount; ++i) {
+      aOut << "  " << cModeNames[i] << ": " << modes[i] << " (" << percent(modes[i], operands) << "%)\n";
+    }
+    aOut << "memory: peak " << peakSize << " cells, " << pageAllocations << " page allocations, " << tableGrowths << " page table growths\n";
+    std::vector<size_t> hot;
+    for(size_t i = 0u; i < programCounters.size(); ++i) {
+      if(programCounters[i] > 0u) {
+        hot.push_back(i);
+      }
+      else { // nothing to do
+      }
+    }
+    size_t shown = std::min(aHotCount, hot.size());
+    std::partial_sort(hot.begin(), hot.begin() + shown, hot.end(), [this](size_t const aLeft, size_t const aRight){
+      return programCounters[aLeft] > programCounters[aRight] || (programCounters[aLeft] == programCounters[aRight] && aLeft < aRight);
+    });
+    aOut << "hot addresses:\n";
+    for(size_t i = 0u; i < shown; ++i) {
+      aOut << "  " << hot[i] << ": " << programCounters[hot[i]] << " (" << percent(programCounters[hot[i]], total) << "%)\n";
+    }
+  }
+
+private:
+  static double percent(uint64_t const aCount, uint64_t const aTotal) noexcept {
+    return aTotal == 0u ? 0.0 : std::floor(static_cast<double>(aCount) * 10000.0 / static_cast<double>(aTotal) + 0.5) / 100.0;
+  }
+};
+#endif
+
+// Unbounded FIFO of machine I/O, lock-free for one producer and one consumer thread.
+// Values are kept in fixed-size ring blocks chained as the queue grows, the consumer hands
+// each block it has emptied back to the producer for reuse, so a queue in steady use
+// allocates nothing, and an empty queue allocates nothing at all.
+// Copying, assigning and clear() must not run concurrently with anything.
+template<typename tNumber>
+class IntcodeQueue final {
+private:
+  static size_t constexpr cBlockSize = 64u;
+
+  struct Block final {
+    tNumber             cells[cBlockSize];
+    std::atomic<Block*> next{nullptr};
+  };
+
+  Block                *mHead = nullptr;   // the consumer's block and index in it
+  size_t                mHeadIndex = cBlockSize;
+  Block                *mTail = nullptr;   // the producer's block and index in it
+  size_t                mTailIndex = cBlockSize;
+  std::atomic<Block*>   mFirst{nullptr};   // the block after none, for the first push
+  std::atomic<size_t>   mPushed{0u};
+  std::atomic<size_t>   mPopped{0u};
+  std::atomic<Block*>   mSpare{nullptr};   // an emptied block waiting for the producer
+
+public:
+  IntcodeQueue() = default;
+
+  IntcodeQueue(IntcodeQueue const &aOther) {
+    append(aOther);
+  }
+
+  IntcodeQueue &operator=(IntcodeQueue const &aOther) {
+    if(this != &aOther) {
+      clear();
+      append(aOther);
+    }
+    else { // nothing to do
+    }
+    return *this;
+  }
+
+  ~IntcodeQueue() {
+    clear();
+    delete mSpare.load(std::memory_order_relaxed);
+  }
+
+  // Producer side.
+  void push(tNumber const &aValue) {
+    if(mTailIndex == cBlockSize) {
+      extend();
+    }
+    else { // nothing to do
+    }
+    mTail->cells[mTailIndex] = aValue;
+    ++mTailIndex;
+    mPushed.store(mPushed.load(std::memory_order_relaxed) + 1u, std::memory_order_release);
+  }
+
+  // Producer side, pushes the characters of aText and publishes them at once.
+  void push(std::string_view const aText) {
+    for(auto character : aText) {
+      if(mTailIndex == cBlockSize) {
+        extend();
+      }
+      else { // nothing to do
+      }
+      mTail->cells[mTailIndex] = static_cast<int64_t>(character);
+      ++mTailIndex;
+    }
+    mPushed.store(mPushed.load(std::memory_order_relaxed) + aText.size(), std::memory_order_release);
+  }
+
+  // Consumer side, returns false if the queue is empty.
+  bool pop(tNumber &aValue) {
+    size_t popped = mPopped.load(std::memory_order_relaxed);
+    bool result = popped != mPushed.load(std::memory_order_acquire);
+    if(result) {
+      if(mHeadIndex == cBlockSize) {
+        Block *empty = mHead;
+        mHead = next(mHead);
+        mHeadIndex = 0u;
+        if(empty != nullptr) {
+          delete mSpare.exchange(empty, std::memory_order_release);
+        }
+        else { // nothing to do
+        }
+      }
+      else { // nothing to do
+      }
+      aValue = std::move(mHead->cells[mHeadIndex]);
+      ++mHeadIndex;
+      mPopped.store(popped + 1u, std::memory_order_release);
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+  // Either side or any other thread, except during clear(). The result may be outdated by the time it
+  // is used. mPopped is read first: both counts only grow and mPopped never passes mPushed, so the later
+  // read of mPushed can not be smaller and the difference never wraps.
+  bool empty() const noexcept {
+    size_t popped = mPopped.load(std::memory_order_acquire);
+    return popped == mPushed.load(std::memory_order_acquire);
+  }
+
+  // Like empty().
+  size_t size() const noexcept {
+    size_t popped = mPopped.load(std::memory_order_acquire);
+    return mPushed.load(std::memory_order_acquire) - popped;
+  }
+
+  // Keeps one block as spare, so a queue cleared for each run of a machine does not allocate again.
+  void clear() noexcept {
+    Block *block = (mHead != nullptr ? mHead : mFirst.load(std::memory_order_relaxed));
+    while(block != nullptr) {
+      Block *following = block->next.load(std::memory_order_relaxed);
+      if(mSpare.load(std::memory_order_relaxed) == nullptr) {
+        mSpare.store(block, std::memory_order_relaxed);
+      }
+      else {
+        delete block;
+      }
+      block = following;
+    }
+    mHead = nullptr;
+    mHeadIndex = cBlockSize;
+    mTail = nullptr;
+    mTailIndex = cBlockSize;
+    mFirst.store(nullptr, std::memory_order_relaxed);
+    mPushed.store(0u, std::memory_order_relaxed);
+    mPopped.store(0u, std::memory_order_relaxed);
+  }
+
+private:
+  void extend() {
+    Block *block = mSpare.exchange(nullptr, std::memory_order_acquire);
+    if(block == nullptr) {
+      block = new Block;
+    }
+    else {
+      block->next.store(nullptr, std::memory_order_relaxed);
+    }
+    (mTail != nullptr ? mTail->next : mFirst).store(block, std::memory_order_relaxed);   // published by the release in push()
+    mTail = block;
+    mTailIndex = 0u;
+  }
+
+  Block *next(Block const *aBlock) const noexcept {
+    return (aBlock != nullptr ? aBlock->next : mFirst).load(std::memory_order_relaxed);
+  }
+
+  void append(IntcodeQueue const &aOther) {
+    Block const *block = aOther.mHead;
+    size_t index = aOther.mHeadIndex;
+    for(size_t count = aOther.size(); count > 0u; --count) {
+      if(index == cBlockSize) {
+        block = aOther.next(block);
+        index = 0u;
+      }
+      else { // nothing to do
+      }
+      push(block->cells[index]);
+      ++index;
+    }
+  }
+};
+
+template<typename tNumber>
+class IntcodeMemory final {
+public:
+  static size_t constexpr cPageBits = 9u;
+  static size_t constexpr cPageSize = 1u << cPageBits;
+  static size_t constexpr cPageMask = cPageSize - 1u;
+  static size_t constexpr cMaxPages = 1u << 20u;
+
+private:
+  // Pages never move once allocated, so cell pointers stay valid while the tables grow.
+  // Pages never written are mapped to a shared zero page, so reads need no allocation.
+  // A fork shares its pages until either side writes one, mWrite holds only the pages owned alone.
+  // Memory shared from an image lists the pages not mapped to those of the image in mDirty.
+  std::vector<std::shared_ptr<tNumber[]>> mPages;
+  std::vector<tNumber const*>             mRead;
+  std::vector<tNumber*>                   mWrite;
+  size_t                                  mSize = 0u;
+  IntcodeMemory const                    *mBase = nullptr;   // the image last shared, see reset()
+  std::vector<size_t>                     mDirty;
+
+public:
+  IntcodeMemory() = default;
+  IntcodeMemory(IntcodeMemory &&aOther) = default;
+  IntcodeMemory &operator=(IntcodeMemory &&aOther) = default;
+
+  IntcodeMemory(IntcodeMemory const &aOther) {
+    *this = aOther;
+  }
+
+  // Copies the pages aOther owns alone, and shares those it shares already, like the pages of a program image.
+  IntcodeMemory &operator=(IntcodeMemory const &aOther) {
+    if(this != &aOther) {
+      mPages.assign(aOther.mPages.size(), nullptr);
+      mRead.assign(aOther.mRead.size(), zeroPage());
+      mWrite.assign(aOther.mWrite.size(), nullptr);
+      for(size_t i = 0u; i < aOther.mPages.size(); ++i) {
+        if(aOther.mWrite[i] != nullptr) {
+          allocate(i, aOther.mRead[i]);
+        }
+        else if(aOther.mPages[i] != nullptr) {
+          mPages[i] = aOther.mPages[i];
+          mRead[i]  = aOther.mRead[i];
+        }
+        else { // nothing to do
+        }
+      }
+      mSize  = aOther.mSize;
+      mBase  = aOther.mBase;
+      mDirty = aOther.mDirty;
+    }
+    else { // nothing to do
+    }
+    return *this;
+  }
+
+  // Returns a copy sharing all pages with this memory in O(pages). Each side copies a page when it first writes it.
+  IntcodeMemory fork() {
+    IntcodeMemory result;
+    result.mPages = mPages;
+    result.mRead  = mRead;
+    result.mWrite.assign(mWrite.size(), nullptr);
+    result.mSize  = mSize;
+    result.mBase  = mBase;
+    result.mDirty = mDirty;
+    std::fill(mWrite.begin(), mWrite.end(), nullptr);
+    return result;
+  }
+
+  // Maps the pages of aImage, which must not be written any more, in O(pages). Each page is copied
+  // when first written, so memory started from one image holds only the pages its machine wrote.
+  void share(IntcodeMemory const &aImage) {
+    mPages = aImage.mPages;
+    mRead  = aImage.mRead;
+    mWrite.assign(aImage.mWrite.size(), nullptr);
+    mSize  = aImage.mSize;
+    mBase  = &aImage;
+    mDirty.clear();
+  }
+
+  // Returns to the contents of aImage like share(aImage), but in time proportional to the pages that
+  // differ from it, if aImage is the image this memory was last shared from. Pages written stay owned
+  // and get the image contents copied back, so a restarted machine writing the same pages allocates
+  // nothing. Calls aChanged(address) for each cell getting another value. Returns false and does
+  // nothing when the memory was not shared from aImage.
+  template<typename tChanged>
+  bool reset(IntcodeMemory const &aImage, tChanged &&aChanged) {
+    bool result = mBase == &aImage;
+    if(result) {
+      size_t kept = 0u;
+      for(auto page : mDirty) {
+        tNumber const *source = aImage.pageAt(page);
+        tNumber const *current = mRead[page];
+        for(size_t i = 0u; i < cPageSize; ++i) {
+          if(current[i] != source[i]) {
+            aChanged((page << cPageBits) + i);
+          }
+          else { // nothing to do
+          }
+        }
+        if(mWrite[page] != nullptr) {
+          std::copy(source, source + cPageSize, mWrite[page]);
+          mDirty[kept] = page;
+          ++kept;
+        }
+        else {
+          mPages[page] = (page < aImage.mPages.size() ? aImage.mPages[page] : nullptr);
+          mRead[page]  = source;
+        }
+      }
+      mDirty.resize(kept);
+      mSize = aImage.mSize;
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+  void assign(std::vector<tNumber> const &aCells) {
+    size_t pageCount = (aCells.size() + cPageMask) >> cPageBits;
+    mBase = nullptr;
+    mDirty.clear();
+    size_t i;
+    for(i = 0u; i < mPages.size(); ++i) {
+      if(mWrite[i] != nullptr) {
+        std::fill(mWrite[i], mWrite[i] + cPageSize, tNumber(0));
+      }
+      else if(mPages[i] != nullptr) {
+        mPages[i].reset();
+        mRead[i] = zeroPage();
+      }
+      else { // nothing to do
+      }
+    }
+    for(i = 0u; i < pageCount; ++i) {
+      auto begin = aCells.begin() + (i << cPageBits);
+      auto end   = aCells.begin() + std::min(aCells.size(), (i + 1u) << cPageBits);
+      std::copy(begin, end, writablePage(i));
+    }
+    mSize = aCells.size();
+  }
+
+  size_t size() const noexcept {
+    return mSize;
+  }
+
+  tNumber const &read(size_t const aAddress) const noexcept {
+    size_t page = aAddress >> cPageBits;
+    return page < mRead.size() ? mRead[page][aAddress & cPageMask] : zeroPage()[0];
+  }
+
+  tNumber &write(size_t const aAddress) {
+    size_t page = aAddress >> cPageBits;
+    if(aAddress >= mSize) {
+      mSize = aAddress + 1u;
+    }
+    else { // nothing to do
+    }
+    return page < mWrite.size() && mWrite[page] != nullptr ? mWrite[page][aAddress & cPageMask] : writablePage(page)[aAddress & cPageMask];
+  }
+
+  // The page table, for native code reading memory directly. Valid until the next write().
+  tNumber const * const *pages() const noexcept {
+    return mRead.data();
+  }
+
+  // nullptr where a page has not been written yet or is shared with a fork.
+  tNumber * const *writablePages() noexcept {
+    return mWrite.data();
+  }
+
+  size_t pageCount() const noexcept {
+    return mRead.size();
+  }
+
+  // Forks share a page as long as they return the same pointer for it.
+  tNumber const *pageAt(size_t const aPage) const noexcept {
+    return aPage < mRead.size() ? mRead[aPage] : zeroPage();
+  }
+
+  // Returns aCount consecutive cells as a contiguous array, copying only when they straddle a page boundary.
+  tNumber const *fetch(size_t const aAddress, size_t const aCount, tNumber *aBuffer) const noexcept {
+    tNumber const *result;
+    if((aAddress & cPageMask) + aCount <= cPageSize) {
+      result = &read(aAddress);
+    }
+    else {
+      for(size_t i = 0u; i < aCount; ++i) {
+        aBuffer[i] = read(aAddress + i);
+      }
+      result = aBuffer;
+    }
+    return result;
+  }
+
+private:
+  static tNumber const *zeroPage() {
+    static tNumber const cZeroPage[cPageSize] = {};
+    return cZeroPage;
+  }
+
+  tNumber *writablePage(size_t const aPage) {
+    if(aPage >= cMaxPages) {
+      throw std::invalid_argument("Invalid address.");
+    }
+    else { // nothing to do
+    }
+    if(aPage >= mWrite.size()) {
+      size_t size = std::max(aPage + 1u, mWrite.size() * 2u);
+      mPages.resize(size);
+      mRead.resize(size, zeroPage());
+      mWrite.resize(size, nullptr);
+    }
+    else { // nothing to do
+    }
+    tNumber *result = mWrite[aPage];
+    if(result == nullptr) {
+      if(mPages[aPage] != nullptr && mPages[aPage].use_count() == 1) {   // the forks sharing it are gone
+        result = mPages[aPage].get();
+        mWrite[aPage] = result;
+      }
+      else {
+        result = allocate(aPage, mRead[aPage]);
+      }
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+  tNumber *allocate(size_t const aPage, tNumber const *aSource) {
+    if(mBase != nullptr && aSource == mBase->pageAt(aPage)) {
+      mDirty.push_back(aPage);
+    }
+    else { // nothing to do
+    }
+    auto page = std::make_shared<std::array<tNumber, cPageSize>>();   // cells and count in one allocation
+    std::copy(aSource, aSource + cPageSize, page->begin());
+    mPages[aPage] = std::shared_ptr<tNumber[]>(page, page->data());
+    mRead[aPage]  = mPages[aPage].get();
+    mWrite[aPage] = mPages[aPage].get();
+    return mWrite[aPage];
+  }
+};
+
+// Dispatch of run(): threaded code through a label table where the compiler supports
+// computed goto, a plain switch otherwise or when INTCODE_SWITCH_DISPATCH is defined.
+// Where a basic block may start (at the beginning, after jumps and after I/O) control
+// passes to attached native code if a block of it starts there. A budgeted run charges each
+// instruction against its budget before running it, a superinstruction as the two it fuses. With
+// only one step left, it runs the first of them alone, which its decoded form holds unchanged.
+#define INTCODE_ENTER_NATIVE   if constexpr(tNative) { enterNative(programCounter, relativeBase); }
+#define INTCODE_BUDGET_CHECK   if constexpr(tBudgeted) { if(aBudget == 0u) { result = Status::cPreempted; goto finished; } }
+#define INTCODE_BUDGET_STEP    if constexpr(tBudgeted) { opcode = (aBudget < cStepCounts[opcode] ? cUnfusedOpcodes[opcode] : opcode); aBudget -= cStepCounts[opcode]; }
+#define INTCODE_DECODE         INTCODE_BUDGET_CHECK instruction = &decode(programCounter); opcode = instruction->opcode; INTCODE_BUDGET_STEP
+#ifdef INTCODE_PROFILE
+#define INTCODE_PROFILE_STEP   mProfile.step(programCounter, opcode, instruction->modes, cOperandCounts[opcode]);
+#else
+#define INTCODE_PROFILE_STEP
+#endif
+#if defined(__GNUC__) && !defined(INTCODE_SWITCH_DISPATCH)
+#define INTCODE_THREADED_DISPATCH
+#define INTCODE_NEXT           INTCODE_DECODE INTCODE_PROFILE_STEP goto *cHandlers[opcode];
+#define INTCODE_DISPATCH_BEGIN INTCODE_ENTER_NATIVE INTCODE_NEXT
+#define INTCODE_CASE(aOpcode, aLabel) aLabel:
+#define INTCODE_DISPATCH_END
+#else
+#define INTCODE_NEXT           continue;
+#define INTCODE_DISPATCH_BEGIN INTCODE_ENTER_NATIVE while(true) { INTCODE_DECODE INTCODE_PROFILE_STEP switch(opcode) {
+#define INTCODE_CASE(aOpcode, aLabel) case aOpcode:
+#define INTCODE_DISPATCH_END   } }
+#endif
+#define INTCODE_NEXT_BLOCK     INTCODE_ENTER_NATIVE INTCODE_NEXT
+
+template<typename tNumber>
+struct IntcodeNative;
+
+template<typename tNumber>
+class Intcode final : private IntcodeIsa {
+public:
+  class Native;
+  using NativeBlock = size_t (*)(Native &aNative);
+  // Returns native code for the block starting at aBegin and sets aEnd past its last cell,
+  // or returns nullptr if that code can not be compiled. See intcode-jit.h.
+  using NativeCompiler = std::function<NativeBlock(IntcodeMemory<tNumber> const &aMemory, size_t aBegin, size_t &aEnd)>;
+  // Why a run returned: the program halted, it waits for input or was suspended by an output
+  // callback, or it used up the step budget of run(aMaxSteps).
+  enum class Status : uint8_t { cHalted, cSuspended, cPreempted };
+
+private:
+  // Lengths of the decoded instructions: those of the instruction set, then halt and the superinstructions.
+  static size_t constexpr cDecodedLengths[] = {1u, 4u, 4u, 2u, 2u, 3u, 3u, 4u, 4u, 2u, 1u, 7u, 7u, 5u};
+  static size_t constexpr cOperandCounts[] = {0u, 3u, 3u, 1u, 1u, 2u, 2u, 3u, 3u, 1u, 0u, 4u, 4u, 3u};   // operand slots used
+  static_assert([]() {
+    bool result = true;
+    for(int i = 0; i < cInstCount; ++i) {
+      result = result && cDecodedLengths[i] == cInstLengths[i];
+    }
+    return result;
+  }(), "Decoded instructions are as long as those of the set.");
+  static size_t const cOffsetParameter1 =   1u;
+  static size_t const cOffsetParameter2 =   2u;
+  static size_t const cOffsetResult     =   3u;
+  static size_t const cOffsetCompareJumpTarget = 4u;   // operands of the fused jumps, see fuse()
+  static size_t const cOffsetBaseJumpCondition = 2u;
+  static size_t const cOffsetBaseJumpTarget    = 3u;
+  static int    const cNotDecoded       =   0;
+  static int    const cDecodedHalt      = cInstCount;  // halt takes the slot after the instructions of the set
+  static int    const cLessThanJump     = 11;          // superinstructions: a comparison and a jump on its result,
+  static int    const cEqualsJump       = 12;          // and a relative base change followed by a jump, see fuse()
+  static int    const cRelativeBaseJump = 13;
+  static int    constexpr cUnfusedOpcodes[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, cLessThan, cEquals, cRelativeBase};   // the first of those fused
+  static size_t constexpr cStepCounts[]     = {1u, 1u, 1u, 1u, 1u, 1u, 1u, 1u, 1u, 1u, 1u, 2u, 2u, 2u};                  // instructions of the set run
+  static size_t const cMaxSlots         =   4u;          // operands of a decoded instruction, more than cMaxOperands when fused
+  static size_t const cMaxFusedLength   =   7u;
+  static int    const cAsciiLast        = 127;
+  static uint8_t const cCodeDecoded     =   1u;
+  static uint8_t const cCodeNative      =   2u;
+  static uint8_t const cHotCount        =  16u;         // interpreted visits before an address is compiled
+  static uint8_t const cNeverHot        = UINT8_MAX;
+
+  // An instruction decoded once. Immediate operands are kept as values,
+  // the others as absolute addresses or relative base offsets.
+  struct Decoded final {
+    tNumber values[cMaxSlots];
+    int64_t operands[cMaxSlots];
+    uint8_t modes[cMaxSlots];
+    uint8_t opcode = cNotDecoded;
+    bool    jumpIfNot0;   // the kind of the jump fused into the instruction
+  };
+
+  // The program as loaded, shared by all copies of a machine and never written. start() maps the pages
+  // of memory into the machine's own memory.
+  struct Image final {
+    std::vector<tNumber>   program;
+    IntcodeMemory<tNumber> memory;
+  };
+
+  // What is known about the code in memory. Forks share it until either side changes it, see cache().
+  struct CodeCache final {
+    std::vector<Decoded>     decoded;
+    std::vector<uint8_t>     code;            // cCodeDecoded and cCodeNative flags of the blocks a cell belongs to
+    std::vector<NativeBlock> nativeEntries;   // by address, nullptr where no valid block starts
+    std::vector<size_t>      nativeEnds;      // by address, end of the block starting there
+    std::vector<uint8_t>     heat;            // by address, interpreted visits up to cHotCount
+    size_t                   nativeSpan = 0u; // length of the longest native block
+  };
+
+  // A queue owned like a value, so copies of a machine get their own, unless connect() shares it.
+  // It is created when first pushed to, as most forks taken for probing are dropped before.
+  class QueueHandle final {
+  public:
+    std::shared_ptr<IntcodeQueue<tNumber>> queue;
+
+    QueueHandle() = default;
+    QueueHandle(QueueHandle &&aOther) = default;
+    QueueHandle &operator=(QueueHandle &&aOther) = default;
+
+    QueueHandle(QueueHandle const &aOther) : queue(aOther.empty() ? nullptr : std::make_shared<IntcodeQueue<tNumber>>(*aOther.queue)) {
+    }
+
+    QueueHandle &operator=(QueueHandle const &aOther) {
+      if(this != &aOther) {
+        queue = (aOther.empty() ? nullptr : std::make_shared<IntcodeQueue<tNumber>>(*aOther.queue));
+      }
+      else { // nothing to do
+      }
+      return *this;
+    }
+
+    std::shared_ptr<IntcodeQueue<tNumber>> const &shared() {
+      if(queue == nullptr) {
+        queue = std::make_shared<IntcodeQueue<tNumber>>();
+      }
+      else { // nothing to do
+      }
+      return queue;
+    }
+
+    void push(tNumber const &aValue) {
+      shared()->push(aValue);
+    }
+
+    void push(std::string_view const aText) {
+      shared()->push(aText);
+    }
+
+    bool pop(tNumber &aValue) {
+      return queue != nullptr && queue->pop(aValue);
+    }
+
+    bool empty() const noexcept {
+      return queue == nullptr || queue->empty();
+    }
+
+    size_t size() const noexcept {
+      return queue == nullptr ? 0u : queue->size();
+    }
+
+    void clear() noexcept {
+      if(queue != nullptr) {
+        queue->clear();
+      }
+      else { // nothing to do
+      }
+    }
+  };
+
+  QueueHandle                                 mInputs;
+  QueueHandle                                 mOutputs;
+  std::string                                 mAscii;               // text output of runAscii()
+  size_t                                      mAsciiPosition = 0u;  // of the first character not consumed
+  std::shared_ptr<Image const>                mImage = std::make_shared<Image const>();
+  IntcodeMemory<tNumber>                      mMemory;
+  std::shared_ptr<CodeCache>                  mCache = std::make_shared<CodeCache>();
+  Decoded const                              *mDecoded  = nullptr;  // the tables of mCache for the interpreter, see viewCache()
+  uint8_t const                              *mCode     = nullptr;
+  size_t                                      mCodeSize = 0u;
+  size_t                                      mProgramCounter = 0u;
+  size_t                                      mRelativeBase   = 0u;
+  size_t                                      mDecodeCount    = 0u;
+
+  IntcodeNative<tNumber> const *mNative = nullptr;
+  NativeCompiler                mCompiler;
+#ifdef INTCODE_PROFILE
+  IntcodeProfile                mProfile;
+#endif
+
+public:
+  // The view of the machine native code works on. Code generated by intcode2cpp uses read(), store() and
+  // write(), the JIT also reads the data members directly, so this stays a standard layout class.
+  class Native final {
+  public:
+    Intcode               *vm;
+    int64_t                relativeBase;
+    tNumber const * const *pages;          // the page tables of the memory, these pointers are valid until the next write()
+    tNumber * const       *writablePages;
+    size_t                 pageCount;
+    size_t                 size;           // of the memory
+    uint8_t const         *code;           // nonzero where a cell may be code, a write there must go through write()
+    size_t                 codeSize;
+    NativeBlock const     *entries;        // the native block starting at each address or nullptr
+    size_t                 entryCount;
+
+    Native(Intcode &aVm, size_t const aRelativeBase) noexcept
+    : vm(&aVm)
+    , relativeBase(aRelativeBase) {
+      refresh();
+    }
+
+    int64_t read(size_t const aAddress) const noexcept {
+      size_t page = aAddress >> IntcodeMemory<tNumber>::cPageBits;
+      return page < pageCount ? toInt64(pages[page][aAddress & IntcodeMemory<tNumber>::cPageMask]) : 0;
+    }
+
+    // Stores directly into a page the machine owns alone where no cell of code is, like the JIT does,
+    // anything else goes through write(). Returns what write() does.
+    bool store(size_t const aAddress, int64_t const aValue) {
+      size_t page = aAddress >> IntcodeMemory<tNumber>::cPageBits;
+      bool direct = (aAddress >= codeSize || code[aAddress] == 0u) && aAddress < size && writablePages[page] != nullptr;
+      if(direct) {
+        writablePages[page][aAddress & IntcodeMemory<tNumber>::cPageMask] = tNumber(aValue);
+      }
+      else { // nothing to do
+      }
+      return direct ? false : write(aAddress, aValue);
+    }
+
+    // Returns true if the written cell may be native code, so the caller must leave its block.
+    bool write(size_t const aAddress, int64_t const aValue) {
+      bool native = aAddress < codeSize && (code[aAddress] & cCodeNative) != 0u;
+      vm->store(aAddress) = aValue;
+      if(moved()) {
+        refresh();
+      }
+      else { // nothing to do
+      }
+      return native;
+    }
+
+  private:
+    // Tells if a write grew the memory or its page tables, or gave the machine its own code cache.
+    bool moved() const noexcept {
+      return vm->mMemory.size() != size || vm->mMemory.pageCount() != pageCount || vm->mCache->code.data() != code || vm->mCache->nativeEntries.data() != entries;
+    }
+
+    void refresh() noexcept {
+      pages = vm->mMemory.pages();
+      writablePages = vm->mMemory.writablePages();
+      pageCount = vm->mMemory.pageCount();
+      size = vm->mMemory.size();
+      code = vm->mCache->code.data();
+      codeSize = vm->mCache->code.size();
+      entries = vm->mCache->nativeEntries.data();
+      entryCount = vm->mCache->nativeEntries.size();
+    }
+  };
+
+  Intcode() = default;
+
+  Intcode(std::ifstream &aIn) {
+    std::vector<tNumber> program;
+    while(true) {
+      std::string number;
+      std::getline(aIn, number, ',');
+      if(aIn.fail()) {
+        break;
+      }
+      else { // nothing to do
+      }
+      size_t end = number.find_last_not_of(" \t\r\n");
+      if(end != std::string::npos) {
+        number.erase(end + 1u);
+        tNumber integer(number);
+        program.push_back(integer);
+      }
+      else { // nothing to do
+      }
+    }
+    mImage = makeImage(std::move(program));
+  }
+
+  // Takes the program from aSize cells at aProgram, like those of an IntcodeImage.
+  Intcode(int64_t const *aProgram, size_t const aSize)
+  : mImage(makeImage(std::vector<tNumber>(aProgram, aProgram + aSize))) {
+  }
+
+  Intcode(Intcode const &aOther) = default;
+  Intcode(Intcode &&aOther) = default;
+  Intcode &operator=(Intcode const &aOther) = default;
+  Intcode &operator=(Intcode &&aOther) = default;
+
+  // Returns a copy of this machine in its current state. Unlike a plain copy it takes time proportional to
+  // the number of memory pages, not to their contents: both sides share pages until they write them.
+  Intcode fork() {
+    return Intcode(*this, mMemory.fork());
+  }
+
+  // Takes over what aOther, usually a fork of this machine, has learned about the code while running, so
+  // later forks of this one need not decode it again. Where aOther decoded cells holding other values than
+  // here, those instructions are dropped as if this machine had written the cells.
+  void adoptCode(Intcode const &aOther) {
+    if(mCache != aOther.mCache) {
+      mCache = aOther.mCache;
+      viewCache();
+      auto const &code = aOther.mCache->code;
+      size_t pageCount = std::max(mMemory.pageCount(), aOther.mMemory.pageCount());
+      for(size_t page = 0u; page < pageCount; ++page) {
+        size_t begin = page << IntcodeMemory<tNumber>::cPageBits;
+        size_t end = std::min(begin + IntcodeMemory<tNumber>::cPageSize, code.size());
+        if(begin < end && mMemory.pageAt(page) != aOther.mMemory.pageAt(page)) {
+          for(size_t i = begin; i < end; ++i) {
+            if(code[i] != 0u && mMemory.read(i) != aOther.mMemory.read(i)) {
+              invalidate(i);
+            }
+            else { // nothing to do
+            }
+          }
+        }
+        else { // nothing to do
+        }
+      }
+    }
+    else { // nothing to do
+    }
+  }
+
+  // Instructions decoded since construction, forks start with the count of their origin.
+  size_t decodeCount() const noexcept {
+    return mDecodeCount;
+  }
+
+  void input(tNumber const &aInput) {
+    mInputs.push(aInput);
+  }
+
+  void input(int64_t const aInput) {
+    mInputs.push(aInput);
+  }
+
+  void input(std::string_view const aInput) {
+    mInputs.push(aInput);
+  }
+
+  // Numbers convert from std::string too, this takes it as text.
+  void input(std::string const &aInput) {
+    mInputs.push(std::string_view(aInput));
+  }
+
+  void inputLine(std::string_view const aInput) {
+    mInputs.push(aInput);
+    mInputs.push(static_cast<int64_t>('\n'));
+  }
+
+  tNumber output() {
+    return get(mOutputs);
+  }
+
+  std::string outputLine() {
+    std::string line;
+    while(hasOutput()) {
+      int64_t ch = get(mOutputs).toInt();
+      if(ch != '\n') {
+        line.push_back(ch);
+      }
+      else if(line.size() > 0u) {
+        break;
+      }
+      else { // nothing to do
+      }
+    }
+    return line;
+  }
+
+  void skipOutput() {
+    mOutputs.clear();
+  }
+
+  bool hasOutput() const noexcept {
+    return !mOutputs.empty();
+  }
+
+  // Text not consumed yet by asciiLine() or skipAscii().
+  std::string_view ascii() const noexcept {
+    return std::string_view(mAscii).substr(mAsciiPosition);
+  }
+
+  // Like outputLine() for the text of runAscii(): returns the next line that is not empty, without its
+  // newline, or what is left of the text. The view is valid until the next runAscii().
+  std::string_view asciiLine() noexcept {
+    std::string_view text = ascii();
+    size_t begin = text.find_first_not_of('\n');
+    size_t end = text.find('\n', begin);
+    std::string_view result = (begin == std::string_view::npos ? std::string_view() : text.substr(begin, end - begin));
+    mAsciiPosition = (end == std::string_view::npos ? mAscii.size() : mAsciiPosition + end + 1u);
+    return result;
+  }
+
+  bool hasAscii() const noexcept {
+    return mAsciiPosition < mAscii.size();
+  }
+
+  void skipAscii() noexcept {
+    mAsciiPosition = mAscii.size();
+  }
+
+  // The queues the program reads its input from and writes its output to. Each may be
+  // pushed by one thread and popped by another while the machine runs.
+  std::shared_ptr<IntcodeQueue<tNumber>> const &inputQueue() {
+    return mInputs.shared();
+  }
+
+  std::shared_ptr<IntcodeQueue<tNumber>> const &outputQueue() {
+    return mOutputs.shared();
+  }
+
+  // Makes the output queue of this machine the input queue of aReceiver, so the values pass
+  // without copying, even to a receiver running on another thread. Copies of either machine
+  // get queues of their own again.
+  void connect(Intcode &aReceiver) {
+    aReceiver.mInputs.queue = mOutputs.shared();
+  }
+
+  void printStatus() const noexcept {
+    std::cout << "input: " << mInputs.size() << " output: " << mOutputs.size() << " memory: " << mMemory.size() << '\n';
+  }
+
+  // Uses native code generated by intcode2cpp for this program from the next start() on.
+  void attach(IntcodeNative<tNumber> const &aNative) {
+    auto const &program = mImage->program;
+    bool same = aNative.programSize == program.size();
+    for(size_t i = 0u; same && i < program.size(); ++i) {
+      same = toInt64(program[i]) == aNative.program[i];
+    }
+    if(!same) {
+      throw std::invalid_argument("Native code was generated for another program.");
+    }
+    else { // nothing to do
+    }
+    mNative = &aNative;
+  }
+
+  // Compiles the blocks the interpreter runs often using aCompiler from the next start() on.
+  void attach(NativeCompiler const &aCompiler) {
+    mCompiler = aCompiler;
+  }
+
+  // Restarting a machine only restores the pages it has written. What it decoded and compiled of the
+  // program is kept, except for the code in cells the restore changes, as if the machine wrote them.
+  void start() {
+    mInputs.clear();
+    mOutputs.clear();
+    mAscii.clear();
+    mAsciiPosition = 0u;
+    auto changed = [this](size_t const aAddress) {
+      if(aAddress < mCodeSize && mCode[aAddress] != 0u) {
+        invalidate(aAddress);
+      }
+      else { // nothing to do
+      }
+    };
+    if(!mMemory.reset(mImage->memory, changed)) {
+      mMemory.share(mImage->memory);
+      if(mCache.use_count() > 1) {
+        mCache = std::make_shared<CodeCache>();
+        viewCache();
+      }
+      else {
+        std::fill(mCache->decoded.begin(), mCache->decoded.end(), Decoded());
+        std::fill(mCache->code.begin(), mCache->code.end(), 0u);
+        std::fill(mCache->nativeEntries.begin(), mCache->nativeEntries.end(), nullptr);
+        std::fill(mCache->nativeEnds.begin(), mCache->nativeEnds.end(), 0u);
+        std::fill(mCache->heat.begin(), mCache->heat.end(), 0u);
+        mCache->nativeSpan = 0u;
+      }
+    }
+    else { // nothing to do
+    }
+    if(mNative != nullptr) {
+      for(size_t i = 0u; i < mNative->blockCount; ++i) {
+        auto const &block = mNative->blocks[i];
+        if(block.begin >= mCache->nativeEntries.size() || mCache->nativeEntries[block.begin] != block.function) {
+          addNative(block.begin, block.end, block.function);
+        }
+        else { // nothing to do
+        }
+      }
+    }
+    else { // nothing to do
+    }
+    mProgramCounter = 0u;
+    mRelativeBase   = 0u;
+  }
+
+  void poke(size_t const aLocation, tNumber const &aValue) {
+    store(aLocation) = aValue;
+  }
+
+  tNumber const &peek(size_t const aLocation) const noexcept {
+    return mMemory.read(aLocation);
+  }
+
+  // The program as loaded, before start() and the program's own writes.
+  std::vector<tNumber> const &program() const noexcept {
+    return mImage->program;
+  }
+
+  size_t memorySize() const noexcept {
+    return mMemory.size();
+  }
+
+  size_t programCounter() const noexcept {
+    return mProgramCounter;
+  }
+
+  size_t relativeBase() const noexcept {
+    return mRelativeBase;
+  }
+
+  // Makes the next run() continue at aProgramCounter with aRelativeBase, like restoring a saved state.
+  void resume(size_t const aProgramCounter, size_t const aRelativeBase) noexcept {
+    mProgramCounter = aProgramCounter;
+    mRelativeBase   = aRelativeBase;
+  }
+
+#ifdef INTCODE_PROFILE
+  // Counts of everything this machine ran, over all start() calls. Forks start with the counts of their origin.
+  IntcodeProfile const &profile() const noexcept {
+    return mProfile;
+  }
+
+#endif
+  // Runs until the program halts, returning true, or waits for input missing from the input() queue,
+  // returning false. Outputs are queued for output().
+  bool run() {
+    auto input = [this](tNumber &aValue) {
+      return mInputs.pop(aValue);
+    };
+    auto output = [this](tNumber const &aValue) {
+      mOutputs.push(aValue);
+      return true;
+    };
+    return run(input, output);
+  }
+
+  // Runs like run(), but returns Status::cPreempted after aMaxSteps instructions if it neither halted
+  // nor waited for input by then, so a scheduler can give many machines bounded time slices. Fused
+  // instructions count as the two they are. The next run resumes where this one stopped. Attached native code chains its blocks without returning,
+  // so budgeted runs only interpret, which also makes them stop at the same instruction every time.
+  Status run(size_t const aMaxSteps) {
+    auto input = [this](tNumber &aValue) {
+      return mInputs.pop(aValue);
+    };
+    auto output = [this](tNumber const &aValue) {
+      mOutputs.push(aValue);
+      return true;
+    };
+    return run(aMaxSteps, input, output);
+  }
+
+  // Runs like run(), but collects the outputs in the ASCII range as text for ascii() and asciiLine()
+  // instead of queueing them, so text protocols pass their lines without handling single characters.
+  // Other outputs, like the final number of such programs, are still queued for output().
+  bool runAscii() {
+    mAscii.erase(0u, mAsciiPosition);
+    mAsciiPosition = 0u;
+    auto input = [this](tNumber &aValue) {
+      return mInputs.pop(aValue);
+    };
+    auto output = [this](tNumber const &aValue) {
+      int64_t value = (fitsInt64(aValue) ? toInt64(aValue) : -1);
+      if(value >= 0 && value <= cAsciiLast) {
+        mAscii.push_back(static_cast<char>(value));
+      }
+      else {
+        mOutputs.push(aValue);
+      }
+      return true;
+    };
+    return run(input, output);
+  }
+
+  // Runs with the I/O going through callbacks instead of the queues. aInput is called as bool(tNumber &)
+  // for each input instruction and either sets the value and returns true, or returns false to suspend
+  // the machine there. aOutput is called as bool(tNumber const &) for each output and returns false to
+  // suspend the machine right after it. Returns true on halt and false when suspended, the next run()
+  // resumes where this one stopped. The callbacks must not use this machine.
+  template<typename tInput, typename tOutput>
+  bool run(tInput &&aInput, tOutput &&aOutput) {
+    return (mNative == nullptr && !mCompiler ? execute<false, false>(aInput, aOutput, 0u) : execute<true, false>(aInput, aOutput, 0u)) == Status::cHalted;
+  }
+
+  // Runs with callbacks like run(aInput, aOutput), with a budget of aMaxSteps like run(aMaxSteps).
+  template<typename tInput, typename tOutput>
+  Status run(size_t const aMaxSteps, tInput &&aInput, tOutput &&aOutput) {
+    return execute<false, true>(aInput, aOutput, aMaxSteps);
+  }
+
+private:
+  Intcode(Intcode const &aOther, IntcodeMemory<tNumber> &&aMemory)
+  : mInputs(aOther.mInputs)
+  , mOutputs(aOther.mOutputs)
+  , mAscii(aOther.mAscii)
+  , mAsciiPosition(aOther.mAsciiPosition)
+  , mImage(aOther.mImage)
+  , mMemory(std::move(aMemory))
+  , mCache(aOther.mCache)
+  , mDecoded(aOther.mDecoded)
+  , mCode(aOther.mCode)
+  , mCodeSize(aOther.mCodeSize)
+  , mProgramCounter(aOther.mProgramCounter)
+  , mRelativeBase(aOther.mRelativeBase)
+  , mDecodeCount(aOther.mDecodeCount)
+  , mNative(aOther.mNative)
+  , mCompiler(aOther.mCompiler)
+#ifdef INTCODE_PROFILE
+  , mProfile(aOther.mProfile)
+#endif
+  {
+  }
+
+  static std::shared_ptr<Image const> makeImage(std::vector<tNumber> &&aProgram) {
+    auto result = std::make_shared<Image>();
+    result->program = std::move(aProgram);
+    result->memory.assign(result->program);
+    return result;
+  }
+
+  template<bool tNative, bool tBudgeted, typename tInput, typename tOutput>
+  Status execute(tInput &aInput, tOutput &aOutput, size_t aBudget) {
+    Status result;
+    size_t programCounter = mProgramCounter;   // kept in locals, as cell writes could alias the members
+    size_t relativeBase   = mRelativeBase;
+    Decoded const *instruction;
+    int            opcode;
+#ifdef INTCODE_THREADED_DISPATCH
+    static void * const cHandlers[] = { &&invalid, &&add, &&multiply, &&input, &&output, &&jumpIfNot0, &&jumpIf0, &&lessThan, &&equals, &&relativeBase, &&halt, &&lessThanJump, &&equalsJump, &&relativeBaseJump };
+#endif
+    INTCODE_DISPATCH_BEGIN
+    INTCODE_CASE(cAdd, add) {
+      tNumber sum = parameter(*instruction, cOffsetParameter1, relativeBase) + parameter(*instruction, cOffsetParameter2, relativeBase);
+      target(*instruction, cOffsetResult, relativeBase) = sum;
+      programCounter += cDecodedLengths[cAdd];
+      INTCODE_NEXT
+    }
+    INTCODE_CASE(cMultiply, multiply) {
+      tNumber product = parameter(*instruction, cOffsetParameter1, relativeBase) * parameter(*instruction, cOffsetParameter2, relativeBase);
+      target(*instruction, cOffsetResult, relativeBase) = product;
+      programCounter += cDecodedLengths[cMultiply];
+      INTCODE_NEXT
+    }
+    INTCODE_CASE(cInput, input) {
+      tNumber value;
+      if(!aInput(value)) {
+        result = Status::cSuspended;
+        goto finished;
+      }
+      else {
+        target(*instruction, cOffsetParameter1, relativeBase) = std::move(value);
+      }
+      programCounter += cDecodedLengths[cInput];
+      INTCODE_NEXT_BLOCK
+    }
+    INTCODE_CASE(cOutput, output) {
+      programCounter += cDecodedLengths[cOutput];
+      if(!aOutput(parameter(*instruction, cOffsetParameter1, relativeBase))) {
+        result = Status::cSuspended;
+        goto finished;
+      }
+      else { // nothing to do
+      }
+      INTCODE_NEXT_BLOCK
+    }
+    INTCODE_CASE(cJumpIfNot0, jumpIfNot0) {
+      if(parameter(*instruction, cOffsetParameter1, relativeBase) != 0) {
+        programCounter = toInt64(parameter(*instruction, cOffsetParameter2, relativeBase));
+      }
+      else {
+        programCounter += cDecodedLengths[cJumpIfNot0];
+      }
+      INTCODE_NEXT_BLOCK
+    }
+    INTCODE_CASE(cJumpIf0, jumpIf0) {
+      if(parameter(*instruction, cOffsetParameter1, relativeBase) == 0) {
+        programCounter = toInt64(parameter(*instruction, cOffsetParameter2, relativeBase));
+      }
+      else {
+        programCounter += cDecodedLengths[cJumpIf0];
+      }
+      INTCODE_NEXT_BLOCK
+    }
+    INTCODE_CASE(cLessThan, lessThan) {
+      tNumber less = (parameter(*instruction, cOffsetParameter1, relativeBase) < parameter(*instruction, cOffsetParameter2, relativeBase) ? 1 : 0);
+      target(*instruction, cOffsetResult, relativeBase) = less;
+      programCounter += cDecodedLengths[cLessThan];
+      INTCODE_NEXT
+    }
+    INTCODE_CASE(cEquals, equals) {
+      tNumber equal = (parameter(*instruction, cOffsetParameter1, relativeBase) == parameter(*instruction, cOffsetParameter2, relativeBase) ? 1 : 0);
+      target(*instruction, cOffsetResult, relativeBase) = equal;
+      programCounter += cDecodedLengths[cEquals];
+      INTCODE_NEXT
+    }
+    INTCODE_CASE(cRelativeBase, relativeBase) {
+      relativeBase += toInt64(parameter(*instruction, cOffsetParameter1, relativeBase));
+      programCounter += cDecodedLengths[cRelativeBase];
+      INTCODE_NEXT
+    }
+    INTCODE_CASE(cLessThanJump, lessThanJump) {
+      bool less = parameter(*instruction, cOffsetParameter1, relativeBase) < parameter(*instruction, cOffsetParameter2, relativeBase);
+      programCounter = compareJump(*instruction, programCounter, relativeBase, less);
+      INTCODE_NEXT_BLOCK
+    }
+    INTCODE_CASE(cEqualsJump, equalsJump) {
+      bool equal = parameter(*instruction, cOffsetParameter1, relativeBase) == parameter(*instruction, cOffsetParameter2, relativeBase);
+      programCounter = compareJump(*instruction, programCounter, relativeBase, equal);
+      INTCODE_NEXT_BLOCK
+    }
+    INTCODE_CASE(cRelativeBaseJump, relativeBaseJump) {
+      relativeBase += toInt64(parameter(*instruction, cOffsetParameter1, relativeBase));
+      if((parameter(*instruction, cOffsetBaseJumpCondition, relativeBase) != 0) == instruction->jumpIfNot0) {
+        programCounter = toInt64(parameter(*instruction, cOffsetBaseJumpTarget, relativeBase));
+      }
+      else {
+        programCounter += cDecodedLengths[cRelativeBaseJump];
+      }
+      INTCODE_NEXT_BLOCK
+    }
+    INTCODE_CASE(cDecodedHalt, halt) {
+      result = Status::cHalted;
+      goto finished;
+    }
+    INTCODE_CASE(cNotDecoded, invalid) {
+      throw std::logic_error("Dispatched an undecoded instruction.");
+    }
+    INTCODE_DISPATCH_END
+finished:
+#ifdef INTCODE_PROFILE
+    mProfile.peakSize = std::max(mProfile.peakSize, mMemory.size());
+#endif
+    mProgramCounter = programCounter;
+    mRelativeBase   = relativeBase;
+    return result;
+  }
+
+  void enterNative(size_t &aProgramCounter, size_t &aRelativeBase) {
+    NativeBlock block = nativeBlock(aProgramCounter);
+    while(block != nullptr) {
+#ifdef INTCODE_PROFILE
+      ++mProfile.nativeBlocks;
+#endif
+      Native native(*this, aRelativeBase);
+      aProgramCounter = block(native);
+      aRelativeBase = native.relativeBase;
+      block = nativeBlock(aProgramCounter);
+    }
+  }
+
+  // Returns the native block starting at aAddress, compiling it if it has become hot.
+  NativeBlock nativeBlock(size_t const aAddress) {
+    NativeBlock result = nullptr;
+    if(aAddress < mCache->nativeEntries.size() && mCache->nativeEntries[aAddress] != nullptr) {
+      result = mCache->nativeEntries[aAddress];
+    }
+    else if(mCompiler && aAddress < mMemory.size()) {
+      reserveNative(aAddress + 1u);
+      auto &heat = cache().heat[aAddress];
+      if(heat < cHotCount && ++heat == cHotCount) {
+        size_t end = aAddress;
+        result = mCompiler(mMemory, aAddress, end);
+        if(result != nullptr) {
+          addNative(aAddress, end, result);
+        }
+        else {
+          cache().heat[aAddress] = cNeverHot;
+        }
+      }
+      else { // nothing to do
+      }
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+  void addNative(size_t const aBegin, size_t const aEnd, NativeBlock const aBlock) {
+    reserveNative(aBegin + 1u);
+    reserveCode(aEnd);
+    auto &cache = this->cache();
+    cache.nativeEntries[aBegin] = aBlock;
+    cache.nativeEnds[aBegin] = aEnd;
+    cache.nativeSpan = std::max(cache.nativeSpan, aEnd - aBegin);
+    for(size_t i = aBegin; i < aEnd; ++i) {
+      cache.code[i] |= cCodeNative;
+    }
+  }
+
+  void reserveNative(size_t const aSize) {
+    if(aSize > mCache->nativeEntries.size()) {
+      auto &cache = this->cache();
+      size_t size = std::max(aSize, cache.nativeEntries.size() * 2u);
+      cache.nativeEntries.resize(size, nullptr);
+      cache.nativeEnds.resize(size, 0u);
+      cache.heat.resize(size, 0u);
+    }
+    else { // nothing to do
+    }
+  }
+
+  // The code cache for changing it, copied first if a fork still shares it.
+  CodeCache &cache() {
+    if(mCache.use_count() > 1) {
+      mCache = std::make_shared<CodeCache>(*mCache);
+      viewCache();
+    }
+    else { // nothing to do
+    }
+    return *mCache;
+  }
+
+  // Reading the cache through members of this machine saves the interpreter a load per instruction.
+  void viewCache() noexcept {
+    mDecoded  = mCache->decoded.data();
+    mCode     = mCache->code.data();
+    mCodeSize = mCache->code.size();
+  }
+
+  Decoded const &decode(size_t const aProgramCounter) {
+    return aProgramCounter < mCodeSize && mDecoded[aProgramCounter].opcode != cNotDecoded ? mDecoded[aProgramCounter] : decodeSlow(aProgramCounter);
+  }
+
+  Decoded const &decodeSlow(size_t const aProgramCounter) {
+    if(aProgramCounter >= mMemory.size()) {
+      std::string message("PC: ");
+      message += std::to_string(aProgramCounter);
+      message += " mem: ";
+      message += std::to_string(mMemory.size());
+      throw std::invalid_argument(message);
+    }
+    else { // nothing to do
+    }
+    tNumber const &cell = mMemory.read(aProgramCounter);
+    Word word;
+    if(!split(fitsInt64(cell) ? toInt64(cell) : -1, word)) {
+      throw std::invalid_argument("Invalid program.");
+    }
+    else { // nothing to do
+    }
+    int opcode = (word.opcode == cHalt ? cDecodedHalt : word.opcode);
+    size_t length = word.length;
+    reserveCode(aProgramCounter + cMaxFusedLength);
+    auto &cache = this->cache();
+    Decoded &result = cache.decoded[aProgramCounter];
+    for(size_t offset = 1u; offset < length; ++offset) {
+      size_t i = offset - 1u;
+      tNumber const &operand = mMemory.read(aProgramCounter + offset);
+      result.modes[i] = word.modes[i];
+      if(result.modes[i] == cModeImmediate) {
+        if(opcode == cInput || offset == cOffsetResult) {
+          result.modes[i] = cModePosition;    // writing in immediate mode hits the operand cell
+          result.operands[i] = aProgramCounter + offset;
+        }
+        else {
+          result.values[i] = operand;
+        }
+      }
+      else if(!fitsInt64(operand)) {       // position or relative, split() accepts no other modes
+        throw std::invalid_argument("Invalid address.");
+      }
+      else {
+        result.operands[i] = toInt64(operand);
+      }
+    }
+    opcode = fuse(aProgramCounter, opcode, result);
+    length = cDecodedLengths[opcode];
+    for(size_t offset = 0u; offset < length; ++offset) {
+      cache.code[aProgramCounter + offset] |= cCodeDecoded;
+    }
+    result.opcode = opcode;
+    ++mDecodeCount;
+#ifdef INTCODE_PROFILE
+    ++mProfile.decodes;
+#endif
+    return result;
+  }
+
+  // Fuses the instruction at aAddress, decoded into aResult, with a jump right after it where they run
+  // often together: a comparison with a jump on the cell it writes, which then need not be read again,
+  // and a relative base change with any jump, as in returns. The jump's operands go into the free
+  // slots of aResult. Returns the opcode to run, aOpcode where nothing was fused.
+  int fuse(size_t const aAddress, int const aOpcode, Decoded &aResult) const {
+    int result = aOpcode;
+    size_t next = aAddress + cDecodedLengths[aOpcode];
+    tNumber const &cell = mMemory.read(next);
+    Word word{};
+    bool fusable = (aOpcode == cLessThan || aOpcode == cEquals || aOpcode == cRelativeBase) && next + cInstLengths[cJumpIf0] <= mMemory.size()
+                && split(fitsInt64(cell) ? toInt64(cell) : -1, word) && isJump(word.opcode);
+    int const *modes = word.modes;
+    int opcode = word.opcode;
+    for(size_t i = 0u; fusable && i < 2u; ++i) {
+      fusable = (modes[i] == cModeImmediate || fitsInt64(mMemory.read(next + 1u + i)));
+    }
+    auto take = [this, next, modes, &aResult](size_t const aOperand, size_t const aSlot) {
+      tNumber const &operand = mMemory.read(next + 1u + aOperand);
+      aResult.modes[aSlot] = modes[aOperand];
+      if(modes[aOperand] == cModeImmediate) {
+        aResult.values[aSlot] = operand;
+      }
+      else {
+        aResult.operands[aSlot] = toInt64(operand);
+      }
+    };
+    if(!fusable) { // nothing to do
+    }
+    else if(aOpcode == cRelativeBase) {
+      take(0u, cOffsetBaseJumpCondition - 1u);
+      take(1u, cOffsetBaseJumpTarget - 1u);
+      aResult.jumpIfNot0 = (opcode == cJumpIfNot0);
+      result = cRelativeBaseJump;
+    }
+    else if(modes[0] != cModeImmediate && modes[0] == aResult.modes[cOffsetResult - 1u] && toInt64(mMemory.read(next + 1u)) == aResult.operands[cOffsetResult - 1u]) {
+      take(1u, cOffsetCompareJumpTarget - 1u);
+      aResult.jumpIfNot0 = (opcode == cJumpIfNot0);
+      result = (aOpcode == cLessThan ? cLessThanJump : cEqualsJump);
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+
+  // Stores the result of the comparison of a fused instruction and takes its jump on it, returns where
+  // execution continues. Should the store have changed the fused code, the jump is left to run alone.
+  size_t compareJump(Decoded const &aInstruction, size_t const aProgramCounter, size_t const aRelativeBase, bool const aResult) {
+    int opcode = aInstruction.opcode;
+    bool jump = (aResult == aInstruction.jumpIfNot0);
+    size_t const slot = cOffsetCompareJumpTarget - 1u;
+    uint8_t mode = aInstruction.modes[slot];       // copied, as the store may drop the instruction
+    int64_t operand = aInstruction.operands[slot];
+    tNumber value = (mode == cModeImmediate ? aInstruction.values[slot] : tNumber(0));
+    tNumber result = (aResult ? 1 : 0);
+    target(aInstruction, cOffsetResult, aRelativeBase) = result;
+    size_t programCounter;
+    if(mDecoded[aProgramCounter].opcode != opcode) {
+      programCounter = aProgramCounter + cDecodedLengths[cLessThan];
+    }
+    else if(!jump) {
+      programCounter = aProgramCounter + cDecodedLengths[opcode];
+    }
+    else if(mode == cModeImmediate) {
+      programCounter = toInt64(value);
+    }
+    else {
+      programCounter = toInt64(mMemory.read(mode == cModeRelative ? aRelativeBase + operand : operand));
+    }
+    return programCounter;
+  }
+
+  void reserveCode(size_t const aSize) {
+    if(aSize > mCache->code.size()) {
+      auto &cache = this->cache();
+      size_t size = std::max(aSize, cache.code.size() * 2u);
+      cache.decoded.resize(size);
+      cache.code.resize(size, 0u);
+      viewCache();
+    }
+    else { // nothing to do
+    }
+  }
+
+  static size_t getAddress(Decoded const &aInstruction, size_t const aOffset, size_t const aRelativeBase) noexcept {
+    size_t i = aOffset - 1u;
+    return aInstruction.modes[i] == cModeRelative ? aRelativeBase + aInstruction.operands[i] : aInstruction.operands[i];
+  }
+
+  tNumber const &parameter(Decoded const &aInstruction, size_t const aOffset, size_t const aRelativeBase) const noexcept {
+    return aInstruction.modes[aOffset - 1u] == cModeImmediate ? aInstruction.values[aOffset - 1u] : mMemory.read(getAddress(aInstruction, aOffset, aRelativeBase));
+  }
+
+  tNumber &target(Decoded const &aInstruction, size_t const aOffset, size_t const aRelativeBase) {
+    return store(getAddress(aInstruction, aOffset, aRelativeBase));
+  }
+
+  // Every write goes through here to drop decoded instructions overlapping a written code cell.
+  tNumber &store(size_t const aAddress) {
+    if(aAddress < mCodeSize && mCode[aAddress] != 0u) {
+      invalidate(aAddress);
+    }
+    else { // nothing to do
+    }
+#ifdef INTCODE_PROFILE
+    size_t page = aAddress >> IntcodeMemory<tNumber>::cPageBits;
+    size_t pageCount = mMemory.pageCount();
+    mProfile.pageAllocations += (page < pageCount && mMemory.writablePages()[page] != nullptr ? 0u : 1u);
+    tNumber &result = mMemory.write(aAddress);
+    mProfile.tableGrowths += (mMemory.pageCount() != pageCount ? 1u : 0u);
+    return result;
+#else
+    return mMemory.write(aAddress);
+#endif
+  }
+
+  void invalidate(size_t const aAddress) {
+    auto &cache = this->cache();
+    size_t first = (aAddress >= cMaxFusedLength - 1u ? aAddress - (cMaxFusedLength - 1u) : 0u);
+    for(size_t i = first; i <= aAddress; ++i) {
+      if(cache.decoded[i].opcode != cNotDecoded && i + cDecodedLengths[cache.decoded[i].opcode] > aAddress) {
+        cache.decoded[i].opcode = cNotDecoded;
+      }
+      else { // nothing to do
+      }
+    }
+    // Native blocks covering the cell are dropped for good, the interpreter runs that code from now on.
+    if((cache.code[aAddress] & cCodeNative) != 0u) {
+      size_t last = std::min(aAddress + 1u, cache.nativeEntries.size());
+      for(size_t i = (aAddress >= cache.nativeSpan ? aAddress + 1u - cache.nativeSpan : 0u); i < last; ++i) {
+        if(cache.nativeEnds[i] > aAddress) {
+          cache.nativeEntries[i] = nullptr;
+          cache.nativeEnds[i] = 0u;
+          cache.heat[i] = cNeverHot;
+        }
+        else { // nothing to do
+        }
+      }
+    }
+    else { // nothing to do
+    }
+    cache.code[aAddress] = 0u;
+  }
+
+  tNumber get(QueueHandle &aQueue) {
+    tNumber result;
+    if(!aQueue.pop(result)) {
+      throw std::invalid_argument("List empty.");
+    }
+    else { // nothing to do
+    }
+    return result;
+  }
+};
+
+template<typename tNumber>
+size_t constexpr Intcode<tNumber>::cDecodedLengths[];
+
+template<typename tNumber>
+size_t constexpr Intcode<tNumber>::cOperandCounts[];
+
+template<typename tNumber>
+int constexpr Intcode<tNumber>::cUnfusedOpcodes[];
+
+template<typename tNumber>
+size_t constexpr Intcode<tNumber>::cStepCounts[];
+
+// Native code for one program as written by intcode2cpp: the program it was
+// generated from and a function per basic block, covering cells [begin, end).
+// A block function returns the address where execution continues.
+template<typename tNumber>
+struct IntcodeNative final {
+  struct Block final {
+    size_t                               begin;
+    size_t                               end;
+    typename Intcode<tNumber>::NativeBlock function;
+  };
+
+  int64_t const *program;
+  size_t         programSize;
+  Block const   *blocks;
+  size_t         blockCount;
+};
+
+#undef INTCODE_ENTER_NATIVE
+#undef INTCODE_BUDGET_CHECK
+#undef INTCODE_BUDGET_STEP
+#undef INTCODE_DECODE
+#undef INTCODE_PROFILE_STEP
+#undef INTCODE_NEXT
+#undef INTCODE_NEXT_BLOCK
+#undef INTCODE_DISPATCH_BEGIN
+#undef INTCODE_CASE
+#undef INTCODE_DISPATCH_END
+
+#endif
@@ -0,0 +1,233 @@
+#include "intcode-analysis.h"
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+// Translates an Intcode program into a C++ translation unit with one function
+// per basic block. The result defines an IntcodeNative<Int> to attach to an
+// Intcode<Int> running the same program, see intcode.h.
+// Usage: intcode2cpp program.in name > native.cpp
+//
+// Blocks are found by IntcodeAnalysis, see intcode-analysis.h. Input, output and
+// halt are left to the interpreter, as are jumps to addresses not discovered there.
+// Writes into a block's cells disable it at run time, so self-modifying regions are
+// interpreted. Writes to cells the analysis found no code in are stored directly
+// into the memory pages, checking the code at run time only. Within a block, values
+// are kept in locals and read from there again while no other write may hit their cell.
+
+class Transpiler final : private IntcodeIsa {
+private:
+  static char const * const cMnemonics[];
+
+  // The locals holding what a block has written so far, by constant address and by relative base offset.
+  struct Locals final {
+    std::map<int64_t, std::string> cells;
+    std::map<int64_t, std::string> relative;
+  };
+
+  IntcodeAnalysis mAnalysis;
+
+public:
+  Transpiler(std::ifstream &aIn) : mAnalysis(aIn) {
+  }
+
+  void emit(std::ostream &aOut, std::string const &aName, std::string const &aSource) const {
+    auto const &program = mAnalysis.program();
+    aOut << "// Generated by intcode2cpp from " << aSource << ", do not edit.\n";
+    aOut << "#include \"intcode.h\"\n\n";
+    aOut << "namespace {\n\n";
+    aOut << "using Native = Intcode<Int>::Native;\n\n";
+    aOut << "int64_t const cProgram[] = {";
+    for(size_t i = 0u; i < program.size(); ++i) {
+      aOut << (i % 16u == 0u ? "\n  " : " ") << program[i] << ',';
+    }
+    aOut << "\n};\n\n";
+    std::vector<std::pair<size_t, size_t>> blocks;
+    for(auto leader : mAnalysis.leaders()) {
+      size_t end = emitBlock(aOut, leader);
+      if(end > leader) {
+        blocks.emplace_back(leader, end);
+      }
+      else { // nothing to do
+      }
+    }
+    aOut << "IntcodeNative<Int>::Block const cBlocks[] = {\n";
+    for(auto const &block : blocks) {
+      aOut << "  { " << block.first << "u, " << block.second << "u, block" << block.first << " },\n";
+    }
+    aOut << "};\n\n";
+    aOut << "}\n\n";
+    aOut << "extern IntcodeNative<Int> const " << aName << ";\n";
+    aOut << "IntcodeNative<Int> const " << aName << " = { cProgram, " << program.size() << "u, cBlocks, " << blocks.size() << "u };\n";
+  }
+
+private:
+  // Input, output and halt are left to the interpreter.
+  static bool isInterpreted(Instruction const &aInstruction) noexcept {
+    return aInstruction.opcode == cInput || aInstruction.opcode == cOutput || aInstruction.opcode == cHalt;
+  }
+
+  std::string read(Instruction const &aInstruction, size_t const aIndex, Locals const &aLocals) const {
+    std::string result;
+    int64_t operand = aInstruction.operands[aIndex];
+    int mode = aInstruction.modes[aIndex];
+    auto const &locals = (mode == cModeRelative ? aLocals.relative : aLocals.cells);
+    auto local = locals.find(operand);
+    if(mode == cModeImmediate) {
+      result = "INT64_C(" + std::to_string(operand) + ")";
+    }
+    else if(local != locals.end()) {
+      result = local->second;
+    }
+    else if(mode == cModePosition) {
+      result = "aNative.read(" + std::to_string(operand) + "u)";
+    }
+    else {
+      result = "aNative.read(rb + " + std::to_string(operand) + ")";
+    }
+    return result;
+  }
+
+  // Emits the store of aValue by the instruction at aAddress. Cells of code go through write(),
+  // which tells when the block must be left, the others are stored directly. Forgets the locals
+  // of cells the store may hit and remembers aValue for its own.
+  void store(std::ostream &aOut, size_t const aAddress, Instruction const &aInstruction, std::string const &aValue, std::string const &aLeave, Locals &aLocals) const {
+    size_t const index = aInstruction.length - 2u;
+    int mode = aInstruction.modes[index];
+    int64_t cell = (mode == cModeImmediate ? static_cast<int64_t>(aAddress + 1u + index) : aInstruction.operands[index]);
+    bool code = (mode == cModeImmediate || (mode == cModePosition && cell >= 0 && mAnalysis.isCode(cell)));
+    aOut << "  if(aNative." << (code ? "write(" : "store(") << target(aAddress, aInstruction, index) << ", " << aValue << ")) " << aLeave << aAddress + aInstruction.length << "u; }\n";
+    if(mode == cModeRelative) {
+      aLocals.cells.clear();
+      aLocals.relative[cell] = aValue;
+    }
+    else {
+      aLocals.relative.clear();
+      aLocals.cells[cell] = aValue;
+    }
+  }
+
+  std::string target(size_t const aAddress, Instruction const &aInstruction, size_t const aIndex) const {
+    std::string result;
+    int64_t operand = aInstruction.operands[aIndex];
+    if(aInstruction.modes[aIndex] == cModeImmediate) {   // writes in immediate mode hit the operand itself
+      result = std::to_string(aAddress + 1u + aIndex) + "u";
+    }
+    else if(aInstruction.modes[aIndex] == cModePosition) {
+      result = std::to_string(operand) + "u";
+    }
+    else {
+      result = "rb + " + std::to_string(operand);
+    }
+    return result;
+  }
+
+  std::string describe(size_t const aAddress, Instruction const &aInstruction) const {
+    std::string result = std::to_string(aAddress) + ": " + cMnemonics[aInstruction.opcode];
+    for(size_t i = 0u; i < aInstruction.length - 1u; ++i) {
+      std::string operand = std::to_string(aInstruction.operands[i]);
+      if(aInstruction.modes[i] == cModePosition) {
+        operand = "[" + operand + "]";
+      }
+      else if(aInstruction.modes[i] == cModeRelative) {
+        operand = "[rb + " + operand + "]";
+      }
+      else { // nothing to do
+      }
+      result += (i == 0u ? " " : ", ") + operand;
+    }
+    return result;
+  }
+
+  // Emits the block starting at aLeader, returns the address after its last
+  // instruction, or aLeader if there is nothing worth compiling there.
+  size_t emitBlock(std::ostream &aOut, size_t const aLeader) const {
+    size_t address = aLeader;
+    auto const &instructions = mAnalysis.instructions();
+    auto found = instructions.find(address);
+    if(found == instructions.end() || isInterpreted(found->second)) {
+      return aLeader;
+    }
+    else { // nothing to do
+    }
+    std::string leave = "{ aNative.relativeBase = rb; return ";
+    Locals locals;
+    size_t end = aLeader;
+    aOut << "size_t block" << aLeader << "(Native &aNative) {\n";
+    aOut << "  int64_t rb = aNative.relativeBase;\n";
+    while(found != instructions.end()) {
+      Instruction const &instruction = found->second;
+      size_t next = address + instruction.length;
+      if(isInterpreted(instruction)) {
+        aOut << "  " << leave << address << "u; }\n";
+        break;
+      }
+      else { // nothing to do
+      }
+      aOut << "  // " << describe(address, instruction) << '\n';
+      end = next;
+      if(instruction.opcode == cAdd || instruction.opcode == cMultiply || instruction.opcode == cLessThan || instruction.opcode == cEquals) {
+        std::string a = read(instruction, 0u, locals);
+        std::string b = read(instruction, 1u, locals);
+        std::string value = "value" + std::to_string(address);
+        if(instruction.opcode == cAdd) {
+          aOut << "  int64_t " << value << " = " << a << " + " << b << ";\n";
+        }
+        else if(instruction.opcode == cMultiply) {
+          aOut << "  int64_t " << value << " = " << a << " * " << b << ";\n";
+        }
+        else if(instruction.opcode == cLessThan) {
+          aOut << "  int64_t " << value << " = (" << a << " < " << b << " ? 1 : 0);\n";
+        }
+        else {
+          aOut << "  int64_t " << value << " = (" << a << " == " << b << " ? 1 : 0);\n";
+        }
+        store(aOut, address, instruction, value, leave, locals);
+      }
+      else if(instruction.opcode == cRelativeBase) {
+        aOut << "  rb += " << read(instruction, 0u, locals) << ";\n";
+        locals.relative.clear();
+      }
+      else { // jumps
+        char const *comparison = (instruction.opcode == cJumpIfNot0 ? " != 0" : " == 0");
+        aOut << "  if(" << read(instruction, 0u, locals) << comparison << ") " << leave << read(instruction, 1u, locals) << "; }\n";
+        aOut << "  " << leave << next << "u; }\n";
+        break;
+      }
+      address = next;
+      found = instructions.find(address);
+      if(found == instructions.end() || mAnalysis.leaders().count(address) > 0u) {
+        aOut << "  " << leave << address << "u; }\n";
+        break;
+      }
+      else { // nothing to do
+      }
+    }
+    aOut << "}\n\n";
+    return end;
+  }
+};
+
+char const * const Transpiler::cMnemonics[] = {"", "add", "mul", "in", "out", "jnz", "jz", "lt", "eq", "arb"};
+
+int main(int const argc, char **argv) {
+  try {
+    if(argc < 3) {
+      throw std::invalid_argument("Need input filename and name of the native program.");
+    }
+    std::ifstream in(argv[1]);
+
+    Transpiler transpiler(in);
+    transpiler.emit(std::cout, argv[2], argv[1]);
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,50 @@
+#include "intcode-image.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+// Converts an Intcode program from text into a binary image to load with
+// loadIntcode() or IntcodeImage, see intcode-image.h.
+// Usage: intcode2image program.in program.img
+
+int main(int const argc, char **argv) {
+  try {
+    if(argc < 3) {
+      throw std::invalid_argument("Need input and output filename.");
+    }
+    std::ifstream in(argv[1]);
+    std::vector<int64_t> cells;
+    while(true) {
+      std::string number;
+      std::getline(in, number, ',');
+      if(in.fail()) {
+        break;
+      }
+      else { // nothing to do
+      }
+      size_t end = number.find_last_not_of(" \t\r\n");
+      if(end != std::string::npos) {
+        number.erase(end + 1u);
+        cells.push_back(std::stoll(number));
+      }
+      else { // nothing to do
+      }
+    }
+    std::ofstream out(argv[2], std::ios::binary);
+    IntcodeImage::write(out, cells);
+    if(!out) {
+      throw std::invalid_argument("Can not write image.");
+    }
+    else { // nothing to do
+    }
+    std::cout << cells.size() << " cells\n";
+  }
+  catch(std::exception const &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}